@@ -0,0 +1,602 @@
+#ifndef IMAGEENCODESET
+#define IMAGEENCODESET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+19.10.26:
+imageEncode - writes images to files with no libraries
+
+Images are RGBA, 4 bytes per pixel, top row first (the format of turtleRaster.h)
+PNGs are written as RGB, each row gets whichever PNG filter makes it closest to zero and the rows are compressed with deflate (LZ77 with hash chains and the fixed Huffman codes), which is small for flat colours like sticks on a background
+GIF and APNG animations share one palette (of up to 256 colours) across every frame, imagePaletteMap turns RGBA pixels into indices of it and imageChangedRect finds the part of a frame that differs from the one before, so that each frame only stores that rectangle (drawn over the frame before)
+Y4M video frames are YUV 4:2:0 (BT.601 studio range, each chroma sample is the average of a 2 by 2 block), the planes of a frame follow each other with no padding
+Everything is in an image_buffer_t so that many images can be encoded on different threads at once, only the CRC table is shared (build it with imageCRCInit before starting threads)
+
+example usage:
+image_buffer_t png;
+imageBufferInit(&png);
+imageEncodePNG(&png, pixels, 1280, 720);
+imageBufferWrite(&png, "frame0000.png");
+imageBufferFree(&png);
+*/
+
+#define IMAGE_DEFLATE_WINDOW 32768 // furthest back that a match can be
+#define IMAGE_DEFLATE_HASH 16384 // entries in the table of where each 3 bytes were last seen (power of two)
+#define IMAGE_DEFLATE_CHAIN 32 // earlier positions tried for each match
+#define IMAGE_DEFLATE_MIN_MATCH 3
+#define IMAGE_DEFLATE_MAX_MATCH 258
+
+/* growable array of bytes */
+typedef struct {
+    uint8_t *data;
+    uint32_t length;
+    uint32_t capacity;
+    uint64_t bits; // bits waiting to be written (imageBufferBits)
+    int32_t bitCount;
+} image_buffer_t;
+
+void imageBufferInit(image_buffer_t *buffer) {
+    buffer -> capacity = 4096;
+    buffer -> data = malloc(buffer -> capacity);
+    buffer -> length = 0;
+    buffer -> bits = 0;
+    buffer -> bitCount = 0;
+}
+
+/* make room for length more bytes */
+void imageBufferReserve(image_buffer_t *buffer, uint32_t length) {
+    if (buffer -> length + length > buffer -> capacity) {
+        while (buffer -> length + length > buffer -> capacity) {
+            buffer -> capacity *= 2;
+        }
+        buffer -> data = realloc(buffer -> data, buffer -> capacity);
+    }
+}
+
+void imageBufferAppend(image_buffer_t *buffer, const void *data, uint32_t length) {
+    imageBufferReserve(buffer, length);
+    memcpy(buffer -> data + buffer -> length, data, length);
+    buffer -> length += length;
+}
+
+void imageBufferByte(image_buffer_t *buffer, uint8_t byte) {
+    imageBufferReserve(buffer, 1);
+    buffer -> data[buffer -> length++] = byte;
+}
+
+/* appends a 32 bit number most significant byte first */
+void imageBufferBigEndian(image_buffer_t *buffer, uint32_t value) {
+    uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+    imageBufferAppend(buffer, bytes, 4);
+}
+
+/* appends count bits of value, least significant bit first (the order of deflate and GIF) */
+void imageBufferBits(image_buffer_t *buffer, uint32_t value, int32_t count) {
+    buffer -> bits |= (uint64_t) value << buffer -> bitCount;
+    buffer -> bitCount += count;
+    while (buffer -> bitCount >= 8) {
+        imageBufferByte(buffer, buffer -> bits);
+        buffer -> bits >>= 8;
+        buffer -> bitCount -= 8;
+    }
+}
+
+/* writes out the last bits, padded with zeros to a byte */
+void imageBufferFlushBits(image_buffer_t *buffer) {
+    if (buffer -> bitCount > 0) {
+        imageBufferByte(buffer, buffer -> bits);
+    }
+    buffer -> bits = 0;
+    buffer -> bitCount = 0;
+}
+
+/* writes the buffer to a file, returns -1 if it cannot */
+int32_t imageBufferWrite(image_buffer_t *buffer, const char *filename) {
+    FILE *file = fopen(filename, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t written = fwrite(buffer -> data, 1, buffer -> length, file);
+    fclose(file);
+    return written == buffer -> length ? 0 : -1;
+}
+
+void imageBufferFree(image_buffer_t *buffer) {
+    free(buffer -> data);
+    buffer -> data = NULL;
+    buffer -> length = 0;
+    buffer -> capacity = 0;
+}
+
+uint32_t imageCRCTable[256];
+
+/* builds the CRC table, call before encoding on more than one thread */
+void imageCRCInit() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int32_t k = 0; k < 8; k++) {
+            c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+        }
+        imageCRCTable[n] = c;
+    }
+}
+
+/* CRC-32 of data (crc is 0 to start) */
+uint32_t imageCRC(uint32_t crc, const uint8_t *data, uint32_t length) {
+    if (imageCRCTable[1] == 0) {
+        imageCRCInit();
+    }
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc = imageCRCTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* Adler-32 of data (the zlib checksum) */
+uint32_t imageAdler(const uint8_t *data, uint32_t length) {
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (length > 0) {
+        uint32_t block = length < 5552 ? length : 5552; // the most bytes before b can overflow
+        for (uint32_t i = 0; i < block; i++) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block;
+        length -= block;
+    }
+    return b << 16 | a;
+}
+
+/* writes a fixed Huffman code, deflate codes go most significant bit first */
+void imageDeflateCode(image_buffer_t *out, uint32_t code, int32_t length) {
+    uint32_t reversed = 0;
+    for (int32_t i = 0; i < length; i++) {
+        reversed = reversed << 1 | ((code >> i) & 1);
+    }
+    imageBufferBits(out, reversed, length);
+}
+
+/* writes a literal or length symbol (0 - 287) with the fixed codes */
+void imageDeflateSymbol(image_buffer_t *out, int32_t symbol) {
+    if (symbol < 144) {
+        imageDeflateCode(out, 0x30 + symbol, 8);
+    } else if (symbol < 256) {
+        imageDeflateCode(out, 0x190 + symbol - 144, 9);
+    } else if (symbol < 280) {
+        imageDeflateCode(out, symbol - 256, 7);
+    } else {
+        imageDeflateCode(out, 0xC0 + symbol - 280, 8);
+    }
+}
+
+const uint16_t imageLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t imageLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t imageDistanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t imageDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* writes a match of length bytes distance bytes back */
+void imageDeflateMatch(image_buffer_t *out, int32_t length, int32_t distance) {
+    int32_t code = 28;
+    while (imageLengthBase[code] > length) {
+        code--;
+    }
+    imageDeflateSymbol(out, 257 + code);
+    imageBufferBits(out, length - imageLengthBase[code], imageLengthExtra[code]);
+    code = 29;
+    while (imageDistanceBase[code] > distance) {
+        code--;
+    }
+    imageDeflateCode(out, code, 5);
+    imageBufferBits(out, distance - imageDistanceBase[code], imageDistanceExtra[code]);
+}
+
+/* appends data as a zlib stream (one deflate block with the fixed Huffman codes) */
+void imageDeflate(image_buffer_t *out, const uint8_t *data, uint32_t length) {
+    imageBufferByte(out, 0x78); // deflate with a 32K window
+    imageBufferByte(out, 0x01);
+    imageBufferBits(out, 1, 1); // last block
+    imageBufferBits(out, 1, 2); // fixed codes
+    int32_t *head = malloc(sizeof(int32_t) * IMAGE_DEFLATE_HASH); // last position of each hash
+    int32_t *previous = malloc(sizeof(int32_t) * IMAGE_DEFLATE_WINDOW); // position before each position with the same hash
+    for (int32_t i = 0; i < IMAGE_DEFLATE_HASH; i++) {
+        head[i] = -IMAGE_DEFLATE_WINDOW - 1;
+    }
+    uint32_t i = 0;
+    while (i < length) {
+        int32_t bestLength = 0;
+        int32_t bestDistance = 0;
+        uint32_t hash = 0;
+        if (i + IMAGE_DEFLATE_MIN_MATCH <= length) {
+            hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) * 2654435761u >> 18 & (IMAGE_DEFLATE_HASH - 1);
+            int32_t maxLength = length - i < IMAGE_DEFLATE_MAX_MATCH ? length - i : IMAGE_DEFLATE_MAX_MATCH;
+            int32_t candidate = head[hash];
+            for (int32_t chain = 0; chain < IMAGE_DEFLATE_CHAIN && (int32_t) i - candidate <= IMAGE_DEFLATE_WINDOW && candidate >= 0; chain++) {
+                if (data[candidate + bestLength] == data[i + bestLength]) {
+                    int32_t matched = 0;
+                    while (matched < maxLength && data[candidate + matched] == data[i + matched]) {
+                        matched++;
+                    }
+                    if (matched > bestLength) {
+                        bestLength = matched;
+                        bestDistance = i - candidate;
+                        if (matched == maxLength) {
+                            break;
+                        }
+                    }
+                }
+                int32_t next = previous[candidate % IMAGE_DEFLATE_WINDOW];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+        int32_t step = 1;
+        if (bestLength >= IMAGE_DEFLATE_MIN_MATCH) {
+            imageDeflateMatch(out, bestLength, bestDistance);
+            step = bestLength;
+        } else {
+            imageDeflateSymbol(out, data[i]);
+        }
+        /* remember every position that was passed */
+        for (int32_t k = 0; k < step; k++, i++) {
+            if (i + IMAGE_DEFLATE_MIN_MATCH <= length) {
+                hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) * 2654435761u >> 18 & (IMAGE_DEFLATE_HASH - 1);
+                previous[i % IMAGE_DEFLATE_WINDOW] = head[hash];
+                head[hash] = i;
+            }
+        }
+    }
+    imageDeflateSymbol(out, 256); // end of block
+    imageBufferFlushBits(out);
+    imageBufferBigEndian(out, imageAdler(data, length));
+    free(head);
+    free(previous);
+}
+
+/* appends a PNG chunk */
+void imagePNGChunk(image_buffer_t *out, const char *type, const uint8_t *data, uint32_t length) {
+    imageBufferBigEndian(out, length);
+    uint32_t start = out -> length;
+    imageBufferAppend(out, type, 4);
+    if (length > 0) {
+        imageBufferAppend(out, data, length);
+    }
+    imageBufferBigEndian(out, imageCRC(0, out -> data + start, length + 4));
+}
+
+/* PNG Paeth predictor */
+uint8_t imagePaeth(int32_t a, int32_t b, int32_t c) {
+    int32_t p = a + b - c;
+    int32_t pa = abs(p - a);
+    int32_t pb = abs(p - b);
+    int32_t pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/* writes the rows of a width by height region (starting at pixel x, y of an image that is stride pixels wide) as filtered RGB PNG scanlines to out (height * (1 + width * 3) bytes) */
+void imagePNGFilter(uint8_t *out, const uint8_t *pixels, int32_t stride, int32_t x, int32_t y, int32_t width, int32_t height) {
+    int32_t rowLength = width * 3;
+    uint8_t *row = malloc(rowLength * 2);
+    uint8_t *above = row + rowLength;
+    memset(above, 0, rowLength);
+    uint8_t *candidate = malloc(rowLength * 5);
+    for (int32_t r = 0; r < height; r++) {
+        const uint8_t *source = pixels + ((size_t) (y + r) * stride + x) * 4;
+        for (int32_t i = 0; i < width; i++) {
+            row[i * 3] = source[i * 4];
+            row[i * 3 + 1] = source[i * 4 + 1];
+            row[i * 3 + 2] = source[i * 4 + 2];
+        }
+        /* try every filter and keep the one with the smallest sum (as signed bytes) */
+        uint32_t bestSum = UINT32_MAX;
+        int32_t best = 0;
+        for (int32_t filter = 0; filter < 5; filter++) {
+            uint8_t *filtered = candidate + filter * rowLength;
+            uint32_t sum = 0;
+            for (int32_t i = 0; i < rowLength; i++) {
+                int32_t left = i >= 3 ? row[i - 3] : 0;
+                int32_t up = above[i];
+                int32_t upLeft = i >= 3 ? above[i - 3] : 0;
+                uint8_t predicted = filter == 0 ? 0 : (filter == 1 ? left : (filter == 2 ? up : (filter == 3 ? (left + up) / 2 : imagePaeth(left, up, upLeft))));
+                filtered[i] = row[i] - predicted;
+                sum += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+            }
+            if (sum < bestSum) {
+                bestSum = sum;
+                best = filter;
+            }
+        }
+        uint8_t *line = out + (size_t) r * (1 + rowLength);
+        line[0] = best;
+        memcpy(line + 1, candidate + best * rowLength, rowLength);
+        memcpy(above, row, rowLength);
+    }
+    free(candidate);
+    free(row);
+}
+
+/* appends the signature and IHDR chunk of an 8 bit image, colorType is 2 for RGB and 3 for a palette */
+void imagePNGHeader(image_buffer_t *out, int32_t width, int32_t height, int32_t colorType) {
+    const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    imageBufferAppend(out, signature, 8);
+    uint8_t header[13] = {width >> 24, width >> 16, width >> 8, width, height >> 24, height >> 16, height >> 8, height, 8, colorType, 0, 0, 0}; // 8 bits, deflate, adaptive filtering, no interlace
+    imagePNGChunk(out, "IHDR", header, 13);
+}
+
+/* appends a PNG of an RGBA image */
+void imageEncodePNG(image_buffer_t *out, const uint8_t *pixels, int32_t width, int32_t height) {
+    imagePNGHeader(out, width, height, 2);
+    uint32_t scanlineLength = (uint32_t) height * (1 + width * 3);
+    uint8_t *scanlines = malloc(scanlineLength);
+    imagePNGFilter(scanlines, pixels, width, 0, 0, width, height);
+    image_buffer_t compressed;
+    imageBufferInit(&compressed);
+    imageDeflate(&compressed, scanlines, scanlineLength);
+    imagePNGChunk(out, "IDAT", compressed.data, compressed.length);
+    imagePNGChunk(out, "IEND", NULL, 0);
+    imageBufferFree(&compressed);
+    free(scanlines);
+}
+
+/* bytes in one YUV 4:2:0 frame of width by height pixels */
+uint32_t imageYUVLength(int32_t width, int32_t height) {
+    return (uint32_t) width * height + (uint32_t) ((width + 1) / 2) * ((height + 1) / 2) * 2;
+}
+
+/* converts an RGBA image to YUV 4:2:0 planes (Y, then Cb, then Cr) in out (imageYUVLength bytes) */
+void imageYUV420(uint8_t *out, const uint8_t *pixels, int32_t width, int32_t height) {
+    for (int32_t i = 0; i < width * height; i++) {
+        const uint8_t *pixel = pixels + i * 4;
+        out[i] = ((66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128) >> 8) + 16;
+    }
+    int32_t chromaWidth = (width + 1) / 2;
+    int32_t chromaHeight = (height + 1) / 2;
+    uint8_t *cb = out + width * height;
+    uint8_t *cr = cb + chromaWidth * chromaHeight;
+    for (int32_t y = 0; y < chromaHeight; y++) {
+        int32_t top = y * 2;
+        int32_t bottom = top + 1 < height ? top + 1 : top;
+        for (int32_t x = 0; x < chromaWidth; x++) {
+            int32_t left = x * 2;
+            int32_t right = left + 1 < width ? left + 1 : left;
+            int32_t rgb[3];
+            for (int32_t c = 0; c < 3; c++) {
+                rgb[c] = (pixels[(top * width + left) * 4 + c] + pixels[(top * width + right) * 4 + c] + pixels[(bottom * width + left) * 4 + c] + pixels[(bottom * width + right) * 4 + c] + 2) >> 2;
+            }
+            /* offset by 128 << 8 so that the shift never sees a negative number */
+            cb[y * chromaWidth + x] = (-38 * rgb[0] - 74 * rgb[1] + 112 * rgb[2] + 128 + 32768) >> 8;
+            cr[y * chromaWidth + x] = (112 * rgb[0] - 94 * rgb[1] - 18 * rgb[2] + 128 + 32768) >> 8;
+        }
+    }
+}
+
+/* appends the header of a Y4M stream */
+void imageY4MHeader(image_buffer_t *out, int32_t width, int32_t height, int32_t framesPerSecond) {
+    char header[128];
+    int32_t length = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, framesPerSecond);
+    imageBufferAppend(out, header, length);
+}
+
+#define IMAGE_PALETTE_CACHE 1024 // colours remembered by imagePaletteMap (power of two)
+
+/* writes the index of the nearest palette colour (palette is colors RGB triples) to out for each of count RGBA pixels */
+void imagePaletteMap(uint8_t *out, const uint8_t *pixels, uint32_t count, const uint8_t *palette, int32_t colors) {
+    uint32_t cacheKeys[IMAGE_PALETTE_CACHE]; // RGB + 1 so that 0 is empty
+    uint8_t cacheIndices[IMAGE_PALETTE_CACHE];
+    memset(cacheKeys, 0, sizeof(cacheKeys));
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *pixel = pixels + i * 4;
+        uint32_t key = (pixel[0] << 16 | pixel[1] << 8 | pixel[2]) + 1;
+        uint32_t slot = key * 2654435761u >> 22 & (IMAGE_PALETTE_CACHE - 1);
+        if (cacheKeys[slot] != key) {
+            int32_t best = 0;
+            int32_t bestDistance = INT32_MAX;
+            for (int32_t c = 0; c < colors && bestDistance > 0; c++) {
+                int32_t dr = pixel[0] - palette[c * 3];
+                int32_t dg = pixel[1] - palette[c * 3 + 1];
+                int32_t db = pixel[2] - palette[c * 3 + 2];
+                int32_t distance = dr * dr + dg * dg + db * db;
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = c;
+                }
+            }
+            cacheKeys[slot] = key;
+            cacheIndices[slot] = best;
+        }
+        out[i] = cacheIndices[slot];
+    }
+}
+
+/* finds the smallest rectangle (x, y, width, height) of an indexed image that holds every pixel different from previous, 1 by 1 if there are none (an animation frame cannot be empty) */
+void imageChangedRect(int32_t *rect, const uint8_t *indexed, const uint8_t *previous, int32_t width, int32_t height) {
+    int32_t top = 0;
+    while (top < height && memcmp(indexed + (size_t) top * width, previous + (size_t) top * width, width) == 0) {
+        top++;
+    }
+    if (top == height) {
+        rect[0] = 0;
+        rect[1] = 0;
+        rect[2] = 1;
+        rect[3] = 1;
+        return;
+    }
+    int32_t bottom = height - 1;
+    while (memcmp(indexed + (size_t) bottom * width, previous + (size_t) bottom * width, width) == 0) {
+        bottom--;
+    }
+    int32_t left = width;
+    int32_t right = -1;
+    for (int32_t y = top; y <= bottom; y++) {
+        const uint8_t *row = indexed + (size_t) y * width;
+        const uint8_t *previousRow = previous + (size_t) y * width;
+        for (int32_t x = 0; x < left; x++) {
+            if (row[x] != previousRow[x]) {
+                left = x;
+                break;
+            }
+        }
+        for (int32_t x = width - 1; x > right; x--) {
+            if (row[x] != previousRow[x]) {
+                right = x;
+                break;
+            }
+        }
+    }
+    rect[0] = left;
+    rect[1] = top;
+    rect[2] = right - left + 1;
+    rect[3] = bottom - top + 1;
+}
+
+/* bits needed for a GIF colour table of colors colours (the table has 2^bits entries, at least 2) */
+int32_t imageGIFBits(int32_t colors) {
+    int32_t bits = 1;
+    while ((1 << bits) < colors) {
+        bits++;
+    }
+    return bits;
+}
+
+/* appends the header of a GIF with a global palette (colors RGB triples), loop makes it repeat forever instead of playing once */
+void imageGIFHeader(image_buffer_t *out, int32_t width, int32_t height, const uint8_t *palette, int32_t colors, int32_t loop) {
+    int32_t bits = imageGIFBits(colors);
+    uint8_t header[13] = {'G', 'I', 'F', '8', '9', 'a', width, width >> 8, height, height >> 8, 0xF0 | (bits - 1), 0, 0}; // global colour table, 8 bit colour resolution
+    imageBufferAppend(out, header, 13);
+    imageBufferAppend(out, palette, colors * 3);
+    for (int32_t i = colors; i < 1 << bits; i++) {
+        imageBufferAppend(out, "\0\0\0", 3);
+    }
+    if (loop) {
+        const uint8_t netscape[19] = {0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0}; // repeat forever
+        imageBufferAppend(out, netscape, 19);
+    }
+}
+
+#define IMAGE_LZW_HASH 8192 // entries in the table of codes (power of two, more than 4096)
+
+/* appends a rectangle (x, y, width, height) of an indexed image that is stride pixels wide as GIF LZW data in sub-blocks */
+void imageGIFLZW(image_buffer_t *out, const uint8_t *indexed, int32_t stride, int32_t x, int32_t y, int32_t width, int32_t height, int32_t minCodeSize) {
+    int32_t *keys = malloc(sizeof(int32_t) * IMAGE_LZW_HASH); // prefix code << 8 | index, -1 if empty
+    int16_t *codes = malloc(sizeof(int16_t) * IMAGE_LZW_HASH);
+    image_buffer_t bits;
+    imageBufferInit(&bits);
+    int32_t clear = 1 << minCodeSize;
+    int32_t codeSize = minCodeSize + 1;
+    int32_t maxCode = clear + 1;
+    for (int32_t i = 0; i < IMAGE_LZW_HASH; i++) {
+        keys[i] = -1;
+    }
+    imageBufferBits(&bits, clear, codeSize);
+    int32_t prefix = indexed[(size_t) y * stride + x];
+    for (int32_t r = 0; r < height; r++) {
+        const uint8_t *row = indexed + (size_t) (y + r) * stride + x;
+        for (int32_t i = r == 0 ? 1 : 0; i < width; i++) {
+            int32_t key = prefix << 8 | row[i];
+            uint32_t slot = (uint32_t) key * 2654435761u >> 19 & (IMAGE_LZW_HASH - 1);
+            while (keys[slot] != -1 && keys[slot] != key) {
+                slot = (slot + 1) & (IMAGE_LZW_HASH - 1);
+            }
+            if (keys[slot] == key) {
+                prefix = codes[slot];
+                continue;
+            }
+            imageBufferBits(&bits, prefix, codeSize);
+            keys[slot] = key;
+            codes[slot] = ++maxCode;
+            if (maxCode >= 1 << codeSize) {
+                codeSize++;
+            }
+            if (maxCode == 4095) {
+                /* the table is full, start again */
+                imageBufferBits(&bits, clear, codeSize);
+                for (int32_t k = 0; k < IMAGE_LZW_HASH; k++) {
+                    keys[k] = -1;
+                }
+                codeSize = minCodeSize + 1;
+                maxCode = clear + 1;
+            }
+            prefix = row[i];
+        }
+    }
+    imageBufferBits(&bits, prefix, codeSize);
+    imageBufferBits(&bits, clear + 1, codeSize); // end of information
+    imageBufferFlushBits(&bits);
+    imageBufferByte(out, minCodeSize);
+    for (uint32_t i = 0; i < bits.length; i += 255) {
+        uint32_t length = bits.length - i < 255 ? bits.length - i : 255;
+        imageBufferByte(out, length);
+        imageBufferAppend(out, bits.data + i, length);
+    }
+    imageBufferByte(out, 0);
+    imageBufferFree(&bits);
+    free(keys);
+    free(codes);
+}
+
+/* appends a GIF frame of a rectangle (x, y, width, height) of an indexed image that is stride pixels wide, shown for delay hundredths of a second and left in place under the next frame */
+void imageGIFFrame(image_buffer_t *out, const uint8_t *indexed, int32_t stride, int32_t x, int32_t y, int32_t width, int32_t height, int32_t delay, int32_t colors) {
+    const uint8_t control[8] = {0x21, 0xF9, 4, 1 << 2, delay, delay >> 8, 0, 0}; // graphic control extension, do not dispose
+    imageBufferAppend(out, control, 8);
+    const uint8_t descriptor[10] = {0x2C, x, x >> 8, y, y >> 8, width, width >> 8, height, height >> 8, 0};
+    imageBufferAppend(out, descriptor, 10);
+    int32_t minCodeSize = imageGIFBits(colors);
+    imageGIFLZW(out, indexed, stride, x, y, width, height, minCodeSize < 2 ? 2 : minCodeSize);
+}
+
+/* appends the header of an APNG with a palette (colors RGB triples) and frames frames, loop makes it repeat forever instead of playing once */
+void imageAPNGHeader(image_buffer_t *out, int32_t width, int32_t height, const uint8_t *palette, int32_t colors, int32_t frames, int32_t loop) {
+    imagePNGHeader(out, width, height, 3);
+    uint8_t control[8] = {frames >> 24, frames >> 16, frames >> 8, frames, 0, 0, 0, loop ? 0 : 1}; // number of frames, number of plays (0 is forever)
+    imagePNGChunk(out, "acTL", control, 8);
+    imagePNGChunk(out, "PLTE", palette, colors * 3);
+}
+
+/* appends APNG frame number frame of a rectangle (x, y, width, height) of an indexed image that is stride pixels wide, shown for delayNumerator / delayDenominator seconds and left in place under the next frame (frame 0 must be the whole image) */
+void imageAPNGFrame(image_buffer_t *out, const uint8_t *indexed, int32_t stride, int32_t x, int32_t y, int32_t width, int32_t height, int32_t frame, int32_t delayNumerator, int32_t delayDenominator) {
+    /* fcTL and fdAT chunks share one sequence: frame 0 has a fcTL (its data is the IDAT), every frame after it has a fcTL and one fdAT */
+    uint32_t sequence = frame == 0 ? 0 : frame * 2 - 1;
+    uint8_t control[26] = {
+        sequence >> 24, sequence >> 16, sequence >> 8, sequence,
+        width >> 24, width >> 16, width >> 8, width,
+        height >> 24, height >> 16, height >> 8, height,
+        x >> 24, x >> 16, x >> 8, x,
+        y >> 24, y >> 16, y >> 8, y,
+        delayNumerator >> 8, delayNumerator, delayDenominator >> 8, delayDenominator,
+        0, 0 // do not dispose, replace the rectangle
+    };
+    imagePNGChunk(out, "fcTL", control, 26);
+    /* rows of indices with no filter (the PNG specification's advice for palettes) */
+    uint32_t scanlineLength = (uint32_t) height * (1 + width);
+    uint8_t *scanlines = malloc(scanlineLength);
+    for (int32_t r = 0; r < height; r++) {
+        scanlines[(size_t) r * (1 + width)] = 0;
+        memcpy(scanlines + (size_t) r * (1 + width) + 1, indexed + (size_t) (y + r) * stride + x, width);
+    }
+    image_buffer_t data;
+    imageBufferInit(&data);
+    if (frame == 0) {
+        imageDeflate(&data, scanlines, scanlineLength);
+        imagePNGChunk(out, "IDAT", data.data, data.length);
+    } else {
+        imageBufferBigEndian(&data, sequence + 1);
+        imageDeflate(&data, scanlines, scanlineLength);
+        imagePNGChunk(out, "fdAT", data.data, data.length);
+    }
+    imageBufferFree(&data);
+    free(scanlines);
+}
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef SPATIALGRIDSET
+#define SPATIALGRIDSET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+/*
+19.10.26:
+spatialGrid - uniform grid for finding the point nearest to a position
+
+Points are hashed into square cells by position, so a query only looks at the cells around it and takes the same time no matter how many points there are
+Each point has an id (chosen by the user, ids are array indices so keep them small) and a radius, a point can only be found from inside the square of that radius around it
+Moving a point only unlinks it from its old cell and links it into its new one, so the grid is updated point by point instead of being rebuilt
+
+example usage:
+spatial_grid_t *grid = spatialGridInit(8, 1024);
+spatialGridSet(grid, 3, 10, 20, 2); // point 3 at (10, 20) with radius 2
+double distance;
+int32_t nearest = spatialGridNearest(grid, 11, 19, &distance); // 3
+spatialGridFree(grid);
+*/
+
+typedef struct {
+    double cellSize;
+    int32_t bucketMask; // number of buckets - 1 (number of buckets is a power of two)
+    int32_t *buckets; // first point in each bucket, -1 if empty
+    int32_t capacity; // number of point ids
+    double *x;
+    double *y;
+    double *radius;
+    int32_t *bucket; // bucket of each point, -1 if the point is not in the grid
+    int32_t *next; // doubly linked list of the points in a bucket
+    int32_t *prev;
+    double maxRadius; // largest radius that has been in the grid (how far queries look)
+} spatial_grid_t;
+
+/* cellSize should be around the radius of the points, buckets is rounded up to a power of two */
+spatial_grid_t *spatialGridInit(double cellSize, int32_t buckets) {
+    spatial_grid_t *grid = calloc(1, sizeof(spatial_grid_t));
+    int32_t size = 1;
+    while (size < buckets) {
+        size *= 2;
+    }
+    grid -> cellSize = cellSize;
+    grid -> bucketMask = size - 1;
+    grid -> buckets = malloc(sizeof(int32_t) * size);
+    for (int32_t i = 0; i < size; i++) {
+        grid -> buckets[i] = -1;
+    }
+    return grid;
+}
+
+int32_t spatialGridHash(spatial_grid_t *grid, int64_t cellX, int64_t cellY) {
+    return (int32_t) ((uint64_t) (cellX * 73856093) ^ (uint64_t) (cellY * 19349663)) & grid -> bucketMask;
+}
+
+/* remove a point from the grid */
+void spatialGridRemove(spatial_grid_t *grid, int32_t point) {
+    if (point >= grid -> capacity || grid -> bucket[point] == -1) {
+        return;
+    }
+    if (grid -> prev[point] == -1) {
+        grid -> buckets[grid -> bucket[point]] = grid -> next[point];
+    } else {
+        grid -> next[grid -> prev[point]] = grid -> next[point];
+    }
+    if (grid -> next[point] != -1) {
+        grid -> prev[grid -> next[point]] = grid -> prev[point];
+    }
+    grid -> bucket[point] = -1;
+}
+
+/* link a point into a bucket */
+void spatialGridLink(spatial_grid_t *grid, int32_t point, int32_t bucket) {
+    grid -> bucket[point] = bucket;
+    grid -> prev[point] = -1;
+    grid -> next[point] = grid -> buckets[bucket];
+    if (grid -> buckets[bucket] != -1) {
+        grid -> prev[grid -> buckets[bucket]] = point;
+    }
+    grid -> buckets[bucket] = point;
+}
+
+/* change the number of buckets (a power of two) and rehash every point */
+void spatialGridRehash(spatial_grid_t *grid, int32_t buckets) {
+    free(grid -> buckets);
+    grid -> bucketMask = buckets - 1;
+    grid -> buckets = malloc(sizeof(int32_t) * buckets);
+    for (int32_t i = 0; i < buckets; i++) {
+        grid -> buckets[i] = -1;
+    }
+    for (int32_t point = 0; point < grid -> capacity; point++) {
+        if (grid -> bucket[point] != -1) {
+            spatialGridLink(grid, point, spatialGridHash(grid, (int64_t) floor(grid -> x[point] / grid -> cellSize), (int64_t) floor(grid -> y[point] / grid -> cellSize)));
+        }
+    }
+}
+
+/* add a point to the grid or move it */
+void spatialGridSet(spatial_grid_t *grid, int32_t point, double x, double y, double radius) {
+    if (point >= grid -> capacity) {
+        int32_t capacity = grid -> capacity > 0 ? grid -> capacity : 64;
+        while (capacity <= point) {
+            capacity *= 2;
+        }
+        grid -> x = realloc(grid -> x, sizeof(double) * capacity);
+        grid -> y = realloc(grid -> y, sizeof(double) * capacity);
+        grid -> radius = realloc(grid -> radius, sizeof(double) * capacity);
+        grid -> bucket = realloc(grid -> bucket, sizeof(int32_t) * capacity);
+        grid -> next = realloc(grid -> next, sizeof(int32_t) * capacity);
+        grid -> prev = realloc(grid -> prev, sizeof(int32_t) * capacity);
+        for (int32_t i = grid -> capacity; i < capacity; i++) {
+            grid -> bucket[i] = -1;
+        }
+        grid -> capacity = capacity;
+        /* keep about one bucket per point so that buckets stay short */
+        if (capacity > grid -> bucketMask + 1) {
+            spatialGridRehash(grid, capacity);
+        }
+    }
+    grid -> x[point] = x;
+    grid -> y[point] = y;
+    grid -> radius[point] = radius;
+    if (radius > grid -> maxRadius) {
+        grid -> maxRadius = radius;
+    }
+    int32_t bucket = spatialGridHash(grid, (int64_t) floor(x / grid -> cellSize), (int64_t) floor(y / grid -> cellSize));
+    if (bucket == grid -> bucket[point]) {
+        return;
+    }
+    spatialGridRemove(grid, point);
+    spatialGridLink(grid, point, bucket);
+}
+
+/* nearest point whose radius contains (x, y), -1 if there is none. distance is set to the squared distance to it */
+int32_t spatialGridNearest(spatial_grid_t *grid, double x, double y, double *distance) {
+    int32_t nearest = -1;
+    double nearestDistance = 0;
+    int64_t reach = (int64_t) ceil(grid -> maxRadius / grid -> cellSize);
+    int64_t cellX = (int64_t) floor(x / grid -> cellSize);
+    int64_t cellY = (int64_t) floor(y / grid -> cellSize);
+    for (int64_t i = cellX - reach; i <= cellX + reach; i++) {
+        for (int64_t j = cellY - reach; j <= cellY + reach; j++) {
+            for (int32_t point = grid -> buckets[spatialGridHash(grid, i, j)]; point != -1; point = grid -> next[point]) {
+                double dx = x - grid -> x[point];
+                double dy = y - grid -> y[point];
+                if (fabs(dx) < grid -> radius[point] && fabs(dy) < grid -> radius[point]) {
+                    double pointDistance = dx * dx + dy * dy;
+                    if (nearest == -1 || pointDistance < nearestDistance) {
+                        nearest = point;
+                        nearestDistance = pointDistance;
+                    }
+                }
+            }
+        }
+    }
+    if (distance != NULL) {
+        *distance = nearestDistance;
+    }
+    return nearest;
+}
+
+void spatialGridFree(spatial_grid_t *grid) {
+    free(grid -> buckets);
+    free(grid -> x);
+    free(grid -> y);
+    free(grid -> radius);
+    free(grid -> bucket);
+    free(grid -> next);
+    free(grid -> prev);
+    free(grid);
+}
+
+#endif
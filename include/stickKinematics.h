@@ -0,0 +1,634 @@
+#ifndef STICKKINEMATICSSET
+#define STICKKINEMATICSSET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#ifndef M_PI
+    #define M_PI 3.14159265358979323846
+#endif
+
+/*
+19.10.26:
+stickKinematics - batched forward kinematics for stick figures
+
+A rig is a list of joints, each joint is a limb that starts at the end of its parent (or at the stick's position if the parent is -1) and points along a bearing (degrees, 0 is up, clockwise)
+Joints are stored in depth first order, so every joint comes before its children and the joints attached to joint j are exactly j + 1 to subtreeEnd[j] - 1
+
+Rigs are loaded from a definition file with stickRigLoad, one joint per line:
+name, parent, length, draw, default angle
+parent is the name of another joint (or root for the stick's position) and can come later in the file, draw is line, none or circle followed by its radius
+lines starting with # are ignored
+The joints are reordered depth first (children keep the order they have in the file), this is the order angles are saved in frames
+
+Angles are bearings by default, if rig.localAngles is set they are relative to the parent joint's bearing instead
+Then turning a joint only changes its own angle, and bearings are only worked out by the forward kinematics (stickBatchBearings)
+stickAnglesToLocal and stickAnglesToWorld convert a pose between the two
+
+Poses are stored as a structure of arrays so that each loop runs over many poses at once and can be vectorised by the compiler:
+angles[joint * capacity + pose]
+jointX[0 * capacity + pose] is the stick's position, jointX[(joint + 1) * capacity + pose] is the end of joint
+
+example usage:
+stick_rig_t rig;
+stickRigLoad(&rig, "include/stickRig.txt");
+stick_batch_t *batch = stickBatchInit();
+stickBatchResize(batch, rig.joints, 2);
+batch -> x[0] = ...; batch -> size[0] = ...; batch -> angles[j * batch -> capacity + 0] = ...;
+stickBatchForward(batch, &rig);
+printf("%lf\n", batch -> jointX[(j + 1) * batch -> capacity + 0]);
+stickBatchFree(batch);
+
+stickSolveIK moves the end of a joint to a point by bending the joints above it (analytic for two joints, cyclic coordinate descent for longer chains)
+
+The float versions (stick_batchf_t, stickBatchfForward...) are identical but use single precision, which doubles the number of poses per vector
+*/
+
+#define STICK_MAX_JOINTS 64
+#define STICK_MAX_NAME 32
+
+typedef enum {
+    STICK_DRAW_LINE = 0, // line from the start to the end of the joint
+    STICK_DRAW_CIRCLE = 1, // circle around the end of the joint
+    STICK_DRAW_NONE = 2, // not drawn (only a dot to drag)
+} stick_draw_t;
+
+typedef struct {
+    int32_t joints; // number of joints
+    int8_t localAngles; // angles are relative to the parent joint's bearing (otherwise they are bearings)
+    int32_t parent[STICK_MAX_JOINTS]; // joint this joint starts at the end of, -1 for the stick's position
+    int32_t subtreeEnd[STICK_MAX_JOINTS]; // one past the last joint attached to this joint
+    double length[STICK_MAX_JOINTS]; // length of joint (multiplied by stick size)
+    stick_draw_t draw[STICK_MAX_JOINTS];
+    double radius[STICK_MAX_JOINTS]; // radius of STICK_DRAW_CIRCLE joints (multiplied by stick size)
+    double angle[STICK_MAX_JOINTS]; // default angle
+    char name[STICK_MAX_JOINTS][STICK_MAX_NAME];
+} stick_rig_t;
+
+/* removes spaces from the start and end of a string (in place) */
+char *stickRigTrim(char *string) {
+    while (*string == ' ' || *string == '\t') {
+        string++;
+    }
+    int32_t end = strlen(string);
+    while (end > 0 && (string[end - 1] == ' ' || string[end - 1] == '\t' || string[end - 1] == '\n' || string[end - 1] == '\r')) {
+        end--;
+    }
+    string[end] = '\0';
+    return string;
+}
+
+/* reorders the joints of a rig depth first and fills in subtreeEnd, parents must already be indices into the rig. returns -1 if a joint is not attached to the stick's position (parent loop) */
+int32_t stickRigCompile(stick_rig_t *rig) {
+    stick_rig_t unsorted = *rig;
+    int32_t order[STICK_MAX_JOINTS]; // old index of each new joint
+    int32_t newIndex[STICK_MAX_JOINTS];
+    int32_t stack[STICK_MAX_JOINTS + 1];
+    int32_t stackLength = 0;
+    int32_t sorted = 0;
+    /* push roots in reverse so that the first one is visited first */
+    for (int32_t j = unsorted.joints - 1; j >= 0; j--) {
+        if (unsorted.parent[j] == -1) {
+            stack[stackLength++] = j;
+        }
+    }
+    while (stackLength > 0) {
+        int32_t joint = stack[--stackLength];
+        newIndex[joint] = sorted;
+        order[sorted++] = joint;
+        for (int32_t j = unsorted.joints - 1; j >= 0; j--) {
+            if (unsorted.parent[j] == joint) {
+                stack[stackLength++] = j;
+            }
+        }
+    }
+    if (sorted != unsorted.joints) {
+        return -1;
+    }
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        int32_t old = order[j];
+        rig -> parent[j] = unsorted.parent[old] == -1 ? -1 : newIndex[unsorted.parent[old]];
+        rig -> length[j] = unsorted.length[old];
+        rig -> draw[j] = unsorted.draw[old];
+        rig -> radius[j] = unsorted.radius[old];
+        rig -> angle[j] = unsorted.angle[old];
+        memcpy(rig -> name[j], unsorted.name[old], STICK_MAX_NAME);
+    }
+    /* a joint's subtree ends where the next joint that is not below it starts */
+    for (int32_t j = rig -> joints - 1; j >= 0; j--) {
+        rig -> subtreeEnd[j] = j + 1;
+        for (int32_t k = j + 1; k < rig -> joints && rig -> parent[k] == j; k = rig -> subtreeEnd[k]) {
+            rig -> subtreeEnd[j] = rig -> subtreeEnd[k];
+        }
+    }
+    return 0;
+}
+
+/* loads a rig from a definition file, returns -1 on failure */
+int32_t stickRigLoad(stick_rig_t *rig, const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        printf("Error: file %s not found\n", filename);
+        return -1;
+    }
+    rig -> localAngles = 0;
+    char parentNames[STICK_MAX_JOINTS][STICK_MAX_NAME];
+    char line[256];
+    int32_t lineNumber = 0;
+    rig -> joints = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        char *trimmed = stickRigTrim(line);
+        if (trimmed[0] == '\0' || trimmed[0] == '#') {
+            continue;
+        }
+        char *fields[5];
+        int32_t fieldCount = 0;
+        char *field = trimmed;
+        while (fieldCount < 5) {
+            char *comma = strchr(field, ',');
+            if (comma != NULL) {
+                *comma = '\0';
+            }
+            fields[fieldCount++] = stickRigTrim(field);
+            if (comma == NULL) {
+                break;
+            }
+            field = comma + 1;
+        }
+        if (fieldCount != 5) {
+            printf("Error: %s line %d is not a joint (name, parent, length, draw, default angle)\n", filename, lineNumber);
+            fclose(file);
+            return -1;
+        }
+        if (rig -> joints == STICK_MAX_JOINTS) {
+            printf("Error: %s line %d has more than %d joints\n", filename, lineNumber, STICK_MAX_JOINTS);
+            fclose(file);
+            return -1;
+        }
+        for (int32_t k = 0; k < rig -> joints; k++) {
+            if (strncmp(rig -> name[k], fields[0], STICK_MAX_NAME - 1) == 0) {
+                printf("Error: %s line %d has a second joint named %s\n", filename, lineNumber, rig -> name[k]);
+                fclose(file);
+                return -1;
+            }
+        }
+        int32_t j = rig -> joints;
+        snprintf(rig -> name[j], STICK_MAX_NAME, "%s", fields[0]);
+        snprintf(parentNames[j], STICK_MAX_NAME, "%s", fields[1]);
+        rig -> length[j] = atof(fields[2]);
+        rig -> radius[j] = 0;
+        if (strncmp(fields[3], "circle", 6) == 0) {
+            rig -> draw[j] = STICK_DRAW_CIRCLE;
+            rig -> radius[j] = atof(fields[3] + 6);
+        } else if (strcmp(fields[3], "none") == 0) {
+            rig -> draw[j] = STICK_DRAW_NONE;
+        } else {
+            rig -> draw[j] = STICK_DRAW_LINE;
+        }
+        rig -> angle[j] = atof(fields[4]);
+        rig -> joints++;
+    }
+    fclose(file);
+    if (rig -> joints == 0) {
+        printf("Error: %s has no joints\n", filename);
+        return -1;
+    }
+    /* resolve parent names */
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        rig -> parent[j] = -2;
+        if (strcmp(parentNames[j], "root") == 0) {
+            rig -> parent[j] = -1;
+        }
+        for (int32_t k = 0; k < rig -> joints; k++) {
+            if (strcmp(parentNames[j], rig -> name[k]) == 0) {
+                rig -> parent[j] = k;
+            }
+        }
+        if (rig -> parent[j] == -2) {
+            printf("Error: %s joint %s has unknown parent %s\n", filename, rig -> name[j], parentNames[j]);
+            return -1;
+        }
+    }
+    if (stickRigCompile(rig) == -1) {
+        printf("Error: %s has joints that are not attached to root\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    int32_t count; // number of poses in the batch
+    int32_t capacity; // allocated poses (stride between joints)
+    int32_t joints; // allocated joints
+    double *x; // position of each stick
+    double *y;
+    double *size; // size of each stick
+    double *angles; // bearing of each joint (degrees)
+    double *sin; // sin and cos of each joint's bearing
+    double *cos;
+    double *jointX; // stick position followed by the end of each joint
+    double *jointY;
+} stick_batch_t;
+
+typedef struct {
+    int32_t count;
+    int32_t capacity;
+    int32_t joints;
+    float *x;
+    float *y;
+    float *size;
+    float *angles;
+    float *sin;
+    float *cos;
+    float *jointX;
+    float *jointY;
+} stick_batchf_t;
+
+stick_batch_t *stickBatchInit() {
+    stick_batch_t *batch = calloc(1, sizeof(stick_batch_t));
+    return batch;
+}
+
+/* make room for count poses with the given number of joints (keeps nothing) */
+void stickBatchResize(stick_batch_t *batch, int32_t joints, int32_t count) {
+    if (count > batch -> capacity || joints > batch -> joints) {
+        int32_t capacity = batch -> capacity > 0 ? batch -> capacity : 8;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        if (joints < batch -> joints) {
+            joints = batch -> joints;
+        }
+        free(batch -> x);
+        free(batch -> angles);
+        free(batch -> jointX);
+        batch -> x = malloc(sizeof(double) * capacity * 3);
+        batch -> y = batch -> x + capacity;
+        batch -> size = batch -> y + capacity;
+        batch -> angles = malloc(sizeof(double) * capacity * joints * 3);
+        batch -> sin = batch -> angles + capacity * joints;
+        batch -> cos = batch -> sin + capacity * joints;
+        batch -> jointX = malloc(sizeof(double) * capacity * (joints + 1) * 2);
+        batch -> jointY = batch -> jointX + capacity * (joints + 1);
+        batch -> capacity = capacity;
+        batch -> joints = joints;
+    }
+    batch -> count = count;
+}
+
+void stickBatchFree(stick_batch_t *batch) {
+    free(batch -> x);
+    free(batch -> angles);
+    free(batch -> jointX);
+    free(batch);
+}
+
+/* sin and cos of count angles in degrees, branch free so that the loop vectorises
+reduces to [-45, 45] degrees around a multiple of 90 and uses the taylor series there (error below 1e-12) */
+void stickSinCos(int32_t count, const double *restrict degrees, double *restrict sinOut, double *restrict cosOut) {
+    for (int32_t i = 0; i < count; i++) {
+        double quadrants = degrees[i] * (1.0 / 90.0);
+        int32_t q = (int32_t) (quadrants + (quadrants >= 0 ? 0.5 : -0.5));
+        double r = (degrees[i] - q * 90.0) * (M_PI / 180.0);
+        double r2 = r * r;
+        double s = r * (1 + r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040 + r2 * (1.0 / 362880 + r2 * (-1.0 / 39916800 + r2 * (1.0 / 6227020800)))))));
+        double c = 1 + r2 * (-1.0 / 2 + r2 * (1.0 / 24 + r2 * (-1.0 / 720 + r2 * (1.0 / 40320 + r2 * (-1.0 / 3628800 + r2 * (1.0 / 479001600))))));
+        /* rotate by q quarter turns */
+        double swapS = (q & 1) ? c : s;
+        double swapC = (q & 1) ? s : c;
+        sinOut[i] = (q & 2) ? -swapS : swapS;
+        cosOut[i] = ((q + 1) & 2) ? -swapC : swapC;
+    }
+}
+
+/* adds each joint's parent bearing to it so that local angles become bearings (in place, does nothing for rigs with bearings) */
+void stickBatchBearings(stick_batch_t *batch, stick_rig_t *rig) {
+    if (!rig -> localAngles) {
+        return;
+    }
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        if (rig -> parent[j] != -1) {
+            double *restrict angles = batch -> angles + j * batch -> capacity;
+            const double *restrict parentAngles = batch -> angles + rig -> parent[j] * batch -> capacity;
+            for (int32_t i = 0; i < batch -> count; i++) {
+                angles[i] += parentAngles[i];
+            }
+        }
+    }
+}
+
+/* computes the sin and cos of every joint in the batch */
+void stickBatchSinCos(stick_batch_t *batch, int32_t joints) {
+    for (int32_t j = 0; j < joints; j++) {
+        stickSinCos(batch -> count, batch -> angles + j * batch -> capacity, batch -> sin + j * batch -> capacity, batch -> cos + j * batch -> capacity);
+    }
+}
+
+/* places the end of one joint for count poses */
+void stickJoint(int32_t count, double length, const double *restrict size, const double *restrict startX, const double *restrict startY, const double *restrict sinJ, const double *restrict cosJ, double *restrict endX, double *restrict endY) {
+    for (int32_t i = 0; i < count; i++) {
+        endX[i] = startX[i] + sinJ[i] * length * size[i];
+        endY[i] = startY[i] + cosJ[i] * length * size[i];
+    }
+}
+
+/* positions every joint from batch -> sin and batch -> cos (use this directly if they are already known) */
+void stickBatchChain(stick_batch_t *batch, stick_rig_t *rig) {
+    int32_t count = batch -> count;
+    int32_t capacity = batch -> capacity;
+    memcpy(batch -> jointX, batch -> x, sizeof(double) * count);
+    memcpy(batch -> jointY, batch -> y, sizeof(double) * count);
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        int32_t start = (rig -> parent[j] + 1) * capacity;
+        stickJoint(count, rig -> length[j], batch -> size, batch -> jointX + start, batch -> jointY + start, batch -> sin + j * capacity, batch -> cos + j * capacity, batch -> jointX + (j + 1) * capacity, batch -> jointY + (j + 1) * capacity);
+    }
+}
+
+/* forward kinematics for every pose in the batch */
+void stickBatchForward(stick_batch_t *batch, stick_rig_t *rig) {
+    stickBatchBearings(batch, rig);
+    stickBatchSinCos(batch, rig -> joints);
+    stickBatchChain(batch, rig);
+}
+
+/* joint positions of a single pose, jointX[0] is the stick's position and jointX[j + 1] is the end of joint j */
+void stickPoseForward(stick_rig_t *rig, double x, double y, double size, const double *angles, double *jointX, double *jointY) {
+    double bearings[STICK_MAX_JOINTS];
+    jointX[0] = x;
+    jointY[0] = y;
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        bearings[j] = angles[j];
+        if (rig -> localAngles && rig -> parent[j] != -1) {
+            bearings[j] += bearings[rig -> parent[j]];
+        }
+        double radians = bearings[j] * (M_PI / 180.0);
+        jointX[j + 1] = jointX[rig -> parent[j] + 1] + sin(radians) * rig -> length[j] * size;
+        jointY[j + 1] = jointY[rig -> parent[j] + 1] + cos(radians) * rig -> length[j] * size;
+    }
+}
+
+/* signed difference between two bearings (degrees), along the shortest arc */
+double stickBearingDifference(double from, double to) {
+    double difference = fmod(to - from, 360);
+    if (difference > 180) {
+        difference -= 360;
+    }
+    if (difference < -180) {
+        difference += 360;
+    }
+    return difference;
+}
+
+/* converts the bearings of a pose to angles relative to each joint's parent (in place) */
+void stickAnglesToLocal(stick_rig_t *rig, double *angles) {
+    for (int32_t j = rig -> joints - 1; j >= 0; j--) {
+        if (rig -> parent[j] != -1) {
+            angles[j] -= angles[rig -> parent[j]];
+        }
+    }
+}
+
+/* converts angles relative to each joint's parent to bearings (in place) */
+void stickAnglesToWorld(stick_rig_t *rig, double *angles) {
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        if (rig -> parent[j] != -1) {
+            angles[j] += angles[rig -> parent[j]];
+        }
+    }
+}
+
+/* bearing of a joint in a pose */
+double stickJointBearing(stick_rig_t *rig, const double *angles, int32_t joint) {
+    if (!rig -> localAngles) {
+        return angles[joint];
+    }
+    double bearing = 0;
+    while (joint != -1) {
+        bearing += angles[joint];
+        joint = rig -> parent[joint];
+    }
+    return bearing;
+}
+
+/* returns 1 if ancestor is joint or one of the joints it hangs from */
+int8_t stickJointAncestor(stick_rig_t *rig, int32_t ancestor, int32_t joint) {
+    return joint >= ancestor && joint < rig -> subtreeEnd[ancestor];
+}
+
+/* number of joints from joint to the stick's position (including joint) */
+int32_t stickChainLength(stick_rig_t *rig, int32_t joint) {
+    int32_t length = 0;
+    while (joint != -1) {
+        length++;
+        joint = rig -> parent[joint];
+    }
+    return length;
+}
+
+/* turns a joint by delta degrees, everything attached to it turns with it (with local angles only the joint's own angle changes) */
+void stickRotateJoint(stick_rig_t *rig, double *angles, int32_t joint, double delta) {
+    if (rig -> localAngles) {
+        angles[joint] += delta;
+        return;
+    }
+    for (int32_t j = joint; j < rig -> subtreeEnd[joint]; j++) {
+        angles[j] += delta;
+    }
+}
+
+/*
+inverse kinematics, these move the end of joint to (targetX, targetY) by changing angles (the stick's position never moves)
+they return 1 if the target was reached and 0 if it is out of reach, in which case the chain is left pointing at the target
+*/
+
+/* analytic solve of the joint and its parent, keeps the current bend direction (knees and elbows never flip) */
+int8_t stickSolveTwoBone(stick_rig_t *rig, double x, double y, double size, double *angles, int32_t joint, double targetX, double targetY) {
+    int32_t upper = rig -> parent[joint];
+    if (upper == -1) {
+        return 0;
+    }
+    double jointX[STICK_MAX_JOINTS + 1];
+    double jointY[STICK_MAX_JOINTS + 1];
+    stickPoseForward(rig, x, y, size, angles, jointX, jointY);
+    double startX = jointX[rig -> parent[upper] + 1];
+    double startY = jointY[rig -> parent[upper] + 1];
+    double upperLength = rig -> length[upper] * size;
+    double lowerLength = rig -> length[joint] * size;
+    double distance = sqrt((targetX - startX) * (targetX - startX) + (targetY - startY) * (targetY - startY));
+    if (distance < 1e-9) {
+        return 0;
+    }
+    int8_t reached = 1;
+    double clamped = distance;
+    if (clamped > upperLength + lowerLength) {
+        clamped = upperLength + lowerLength;
+        reached = 0;
+    }
+    if (clamped < fabs(upperLength - lowerLength)) {
+        clamped = fabs(upperLength - lowerLength);
+        reached = 0;
+    }
+    double cosine = (upperLength * upperLength + clamped * clamped - lowerLength * lowerLength) / (2 * upperLength * clamped);
+    cosine = cosine > 1 ? 1 : (cosine < -1 ? -1 : cosine);
+    double bend = acos(cosine) * (180.0 / M_PI);
+    double upperBearing = stickJointBearing(rig, angles, upper);
+    double lowerBearing = stickJointBearing(rig, angles, joint);
+    /* side the middle joint is currently bent towards */
+    double currentBearing = atan2(jointX[joint + 1] - startX, jointY[joint + 1] - startY) * (180.0 / M_PI);
+    if (stickBearingDifference(currentBearing, upperBearing) < 0) {
+        bend = -bend;
+    }
+    double targetBearing = atan2(targetX - startX, targetY - startY) * (180.0 / M_PI);
+    double upperChange = stickBearingDifference(upperBearing, targetBearing + bend);
+    stickRotateJoint(rig, angles, upper, upperChange);
+    double radians = (upperBearing + upperChange) * (M_PI / 180.0);
+    double middleX = startX + sin(radians) * upperLength;
+    double middleY = startY + cos(radians) * upperLength;
+    stickRotateJoint(rig, angles, joint, stickBearingDifference(lowerBearing + upperChange, atan2(targetX - middleX, targetY - middleY) * (180.0 / M_PI)));
+    return reached;
+}
+
+/* cyclic coordinate descent over chainLength joints ending at joint, stops once the end is within tolerance of the target */
+int8_t stickSolveCCD(stick_rig_t *rig, double x, double y, double size, double *angles, int32_t joint, int32_t chainLength, double targetX, double targetY, int32_t iterations, double tolerance) {
+    double jointX[STICK_MAX_JOINTS + 1];
+    double jointY[STICK_MAX_JOINTS + 1];
+    for (int32_t i = 0; i < iterations; i++) {
+        int32_t pivot = joint;
+        for (int32_t k = 0; k < chainLength && pivot != -1; k++) {
+            stickPoseForward(rig, x, y, size, angles, jointX, jointY);
+            double endX = jointX[joint + 1];
+            double endY = jointY[joint + 1];
+            if ((endX - targetX) * (endX - targetX) + (endY - targetY) * (endY - targetY) < tolerance * tolerance) {
+                return 1;
+            }
+            double pivotX = jointX[rig -> parent[pivot] + 1];
+            double pivotY = jointY[rig -> parent[pivot] + 1];
+            double endBearing = atan2(endX - pivotX, endY - pivotY) * (180.0 / M_PI);
+            double targetBearing = atan2(targetX - pivotX, targetY - pivotY) * (180.0 / M_PI);
+            stickRotateJoint(rig, angles, pivot, stickBearingDifference(endBearing, targetBearing));
+            pivot = rig -> parent[pivot];
+        }
+    }
+    stickPoseForward(rig, x, y, size, angles, jointX, jointY);
+    return (jointX[joint + 1] - targetX) * (jointX[joint + 1] - targetX) + (jointY[joint + 1] - targetY) * (jointY[joint + 1] - targetY) < tolerance * tolerance;
+}
+
+/* two bone solve, falling back to bending the whole chain up to the stick's position when the target is out of reach */
+int8_t stickSolveIK(stick_rig_t *rig, double x, double y, double size, double *angles, int32_t joint, double targetX, double targetY) {
+    int32_t chainLength = stickChainLength(rig, joint);
+    if (chainLength < 2) {
+        /* nothing to bend, point at the target */
+        stickRotateJoint(rig, angles, joint, stickBearingDifference(stickJointBearing(rig, angles, joint), atan2(targetX - x, targetY - y) * (180.0 / M_PI)));
+        return 0;
+    }
+    int8_t reached = stickSolveTwoBone(rig, x, y, size, angles, joint, targetX, targetY);
+    if (reached || chainLength == 2) {
+        return reached;
+    }
+    return stickSolveCCD(rig, x, y, size, angles, joint, chainLength, targetX, targetY, 16, size * 0.01);
+}
+
+/* single precision versions */
+stick_batchf_t *stickBatchfInit() {
+    stick_batchf_t *batch = calloc(1, sizeof(stick_batchf_t));
+    return batch;
+}
+
+void stickBatchfResize(stick_batchf_t *batch, int32_t joints, int32_t count) {
+    if (count > batch -> capacity || joints > batch -> joints) {
+        int32_t capacity = batch -> capacity > 0 ? batch -> capacity : 16;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        if (joints < batch -> joints) {
+            joints = batch -> joints;
+        }
+        free(batch -> x);
+        free(batch -> angles);
+        free(batch -> jointX);
+        batch -> x = malloc(sizeof(float) * capacity * 3);
+        batch -> y = batch -> x + capacity;
+        batch -> size = batch -> y + capacity;
+        batch -> angles = malloc(sizeof(float) * capacity * joints * 3);
+        batch -> sin = batch -> angles + capacity * joints;
+        batch -> cos = batch -> sin + capacity * joints;
+        batch -> jointX = malloc(sizeof(float) * capacity * (joints + 1) * 2);
+        batch -> jointY = batch -> jointX + capacity * (joints + 1);
+        batch -> capacity = capacity;
+        batch -> joints = joints;
+    }
+    batch -> count = count;
+}
+
+void stickBatchfFree(stick_batchf_t *batch) {
+    free(batch -> x);
+    free(batch -> angles);
+    free(batch -> jointX);
+    free(batch);
+}
+
+/* single precision sin and cos of degrees (error below 1e-7) */
+void stickSinCosf(int32_t count, const float *restrict degrees, float *restrict sinOut, float *restrict cosOut) {
+    for (int32_t i = 0; i < count; i++) {
+        float quadrants = degrees[i] * (1.0f / 90.0f);
+        int32_t q = (int32_t) (quadrants + (quadrants >= 0 ? 0.5f : -0.5f));
+        float r = (degrees[i] - q * 90.0f) * (float) (M_PI / 180.0);
+        float r2 = r * r;
+        float s = r * (1 + r2 * (-1.0f / 6 + r2 * (1.0f / 120 + r2 * (-1.0f / 5040 + r2 * (1.0f / 362880)))));
+        float c = 1 + r2 * (-1.0f / 2 + r2 * (1.0f / 24 + r2 * (-1.0f / 720 + r2 * (1.0f / 40320))));
+        float swapS = (q & 1) ? c : s;
+        float swapC = (q & 1) ? s : c;
+        sinOut[i] = (q & 2) ? -swapS : swapS;
+        cosOut[i] = ((q + 1) & 2) ? -swapC : swapC;
+    }
+}
+
+void stickBatchfBearings(stick_batchf_t *batch, stick_rig_t *rig) {
+    if (!rig -> localAngles) {
+        return;
+    }
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        if (rig -> parent[j] != -1) {
+            float *restrict angles = batch -> angles + j * batch -> capacity;
+            const float *restrict parentAngles = batch -> angles + rig -> parent[j] * batch -> capacity;
+            for (int32_t i = 0; i < batch -> count; i++) {
+                angles[i] += parentAngles[i];
+            }
+        }
+    }
+}
+
+void stickBatchfSinCos(stick_batchf_t *batch, int32_t joints) {
+    for (int32_t j = 0; j < joints; j++) {
+        stickSinCosf(batch -> count, batch -> angles + j * batch -> capacity, batch -> sin + j * batch -> capacity, batch -> cos + j * batch -> capacity);
+    }
+}
+
+void stickJointf(int32_t count, float length, const float *restrict size, const float *restrict startX, const float *restrict startY, const float *restrict sinJ, const float *restrict cosJ, float *restrict endX, float *restrict endY) {
+    for (int32_t i = 0; i < count; i++) {
+        endX[i] = startX[i] + sinJ[i] * length * size[i];
+        endY[i] = startY[i] + cosJ[i] * length * size[i];
+    }
+}
+
+void stickBatchfChain(stick_batchf_t *batch, stick_rig_t *rig) {
+    int32_t count = batch -> count;
+    int32_t capacity = batch -> capacity;
+    memcpy(batch -> jointX, batch -> x, sizeof(float) * count);
+    memcpy(batch -> jointY, batch -> y, sizeof(float) * count);
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        int32_t start = (rig -> parent[j] + 1) * capacity;
+        stickJointf(count, rig -> length[j], batch -> size, batch -> jointX + start, batch -> jointY + start, batch -> sin + j * capacity, batch -> cos + j * capacity, batch -> jointX + (j + 1) * capacity, batch -> jointY + (j + 1) * capacity);
+    }
+}
+
+void stickBatchfForward(stick_batchf_t *batch, stick_rig_t *rig) {
+    stickBatchfBearings(batch, rig);
+    stickBatchfSinCos(batch, rig -> joints);
+    stickBatchfChain(batch, rig);
+}
+
+#endif
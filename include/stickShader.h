@@ -0,0 +1,443 @@
+#ifndef STICKSHADERSET
+#define STICKSHADERSET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "turtle.h"
+#include "stickKinematics.h"
+
+/*
+19.10.26:
+stickShader - draws sticks on the GPU from their poses
+
+Each stick is uploaded as STICK_SHADER_HEADER + joints floats (position, size, colour, style and the angle of each joint as it is stored in the frame)
+The vertex shader does the forward kinematics, picks the number of sides of each circle for its size on screen and builds the triangles, so the CPU never works out a bearing, a joint position or a circle vertex
+It draws the same triangles in the same order as renderStickJoints does through turtle.h (round lines, heads and the background dot of an open head, with the same number of sides and the same caps left out of thin lines)
+Sticks are added to turtle.penPos with turtleInstance (see stickShaderValues for the values) and every run of them is drawn in one instanced draw call
+The triangles of a stick are indexed so that the vertices of a circle are placed once, not once for every triangle of its fan
+
+Needs OpenGL 3.1 (instanced drawing and buffer textures), stickShaderInit returns -1 without it and sticks should then be drawn with the turtle
+
+example usage:
+stick_shader_t shader;
+if (stickShaderInit(&shader, &rig) == 0) {
+    turtleInstanceRenderer(stickShaderDraw, &shader);
+}
+...
+turtlePenColorAlpha(0, 0, 0, 0);
+turtleInstance(x, y, size, values, stickShaderValues(values, openHead, rig.localAngles, angles, 1, rig.joints));
+*/
+
+/* a stick in the stick buffer is x, y, size, colour (red * 65536 + green * 256 + blue), look (alpha * 2048 + circle precision * 4 + style) and then the angle of each joint */
+#define STICK_SHADER_HEADER 5 // values before the angles of a stick in the stick buffer
+#define STICK_SHADER_OPEN_HEAD 1 // style bits (first value of stickShaderValues)
+#define STICK_SHADER_LOCAL_ANGLES 2
+#define STICK_SHADER_INDEX_BUFFERS 4 // index buffers kept for different circle sizes (onions, thumbnails and live sticks are usually drawn at a few sizes)
+
+/* triangles of one stick whose circles have lineSides and headSides vertices */
+typedef struct {
+    int32_t lineSides; // 0 if the buffer has not been made
+    int32_t headSides;
+    int32_t count; // indices
+    uint32_t buffer;
+} stick_shader_indices_t;
+
+typedef struct {
+    int32_t joints; // joints of the rig the shader was made for
+    double headRadius; // biggest head radius of the rig
+    uint32_t program;
+    uint32_t vertexArray;
+    uint32_t buffer; // stick buffer, STICK_SHADER_HEADER + joints floats per stick
+    uint32_t texture; // buffer texture that the vertex shader reads the stick buffer through
+    int32_t lines; // joints drawn as lines
+    int32_t heads; // joints drawn as circles
+    int32_t strideLocation;
+    int32_t lineSidesLocation;
+    int32_t headSidesLocation;
+    int32_t scaleLocation;
+    int32_t pixelScaleLocation;
+    int32_t backgroundLocation;
+    float *sticks; // stick buffer before it is uploaded
+    int32_t capacity; // sticks that fit in sticks
+    stick_shader_indices_t indices[STICK_SHADER_INDEX_BUFFERS];
+    int32_t indexEvict; // index buffer replaced next
+} stick_shader_t;
+
+/* a stick is drawn in the order of renderStickJoints, first each line (the circle at its start where the pen went down, the quad along it and the circle at its end) and then each head (the head and the background dot of an open head)
+   every circle gets as many vertices as the biggest circle of its kind in the draw, the vertices of a circle that is not drawn are all put at the same point outside the screen and the ones past the sides a circle needs on its first vertex, so that they make no triangles */
+const char *stickShaderVertexSource =
+    "#version 140\n"
+    "uniform samplerBuffer sticks;\n"
+    "uniform int stride;\n"
+    "uniform int joints;\n"
+    "uniform int lines;\n"
+    "uniform int lineSides;\n" // vertices of a line's circle
+    "uniform int headSides;\n" // vertices of a head's circle
+    "uniform vec2 scale;\n"
+    "uniform float pixelScale;\n" // pixels per coordinate
+    "uniform vec4 background;\n" // colour of the dot of an open head
+    "uniform ivec4 rig[64];\n" // parent, draw, whether the pen goes down at the start of this joint, line joint that carries on from the end of this one (or -1)
+    "uniform vec4 rigShape[64];\n" // length, head radius
+    "uniform ivec2 order[64];\n" // joint of each line, joint of each head
+    "flat out vec4 shadeColor;\n"
+    "int base;\n"
+    "bool localAngles;\n"
+    "float value(int index) {\n"
+    "    return texelFetch(sticks, base + index).r;\n"
+    "}\n"
+    "float bearing(float parentBearing, int joint) {\n"
+    "    return localAngles ? parentBearing + value(5 + joint) : value(5 + joint);\n"
+    "}\n"
+    "vec2 along(float bearing, int joint) {\n" // from the start to the end of a joint
+    "    return vec2(sin(radians(bearing)), cos(radians(bearing))) * rigShape[joint].x * value(2);\n"
+    "}\n"
+    "vec2 jointEnd(int joint, out vec2 start, out float jointBearing) {\n" // start is the end of the parent joint, walks from the joint to the stick's position so it needs no stack
+    "    jointBearing = 0.0;\n"
+    "    for (int j = joint; j != -1; j = localAngles ? rig[j].x : -1) {\n"
+    "        jointBearing += value(5 + j);\n"
+    "    }\n"
+    "    vec2 position = vec2(value(0), value(1));\n"
+    "    vec2 first = vec2(0.0);\n"
+    "    float parentBearing = jointBearing;\n"
+    "    for (int j = joint; j != -1; j = rig[j].x) {\n"
+    "        float angle = value(5 + j);\n"
+    "        vec2 step = along(localAngles ? parentBearing : angle, j);\n"
+    "        first = j == joint ? step : first;\n"
+    "        position += step;\n"
+    "        parentBearing -= angle;\n"
+    "    }\n"
+    "    start = position - first;\n"
+    "    return position;\n"
+    "}\n"
+    "int circleSides(float prez, float radius, int most) {\n" // turtleCircleSides, but no more than most
+    "    float sides = ceil(prez * log(2.71 + radius));\n"
+    "    float pixels = radius * pixelScale;\n"
+    "    if (pixelScale > 0.0) {\n"
+    "        sides = min(sides, pixels > 0.25 ? max(ceil(3.14159265 / acos(1.0 - 0.25 / pixels)), 4.0) : 4.0);\n"
+    "    }\n"
+    "    return int(clamp(sides, 3.0, float(most)));\n"
+    "}\n"
+    "bool apart(vec2 start, vec2 end, float radius) {\n" // turtleUpdate only joins pen positions that are far enough apart
+    "    return abs(end.x - start.x) > radius * 0.5 || abs(end.y - start.y) > radius * 0.5;\n"
+    "}\n"
+    "vec2 circleVertex(vec2 center, float radius, int sides, int vertex) {\n" // vertex of turtleCircleRender
+    "    float angle = 6.2831853 * float(vertex < sides ? vertex : 0) / float(sides);\n"
+    "    return center + radius * vec2(sin(angle), cos(angle));\n"
+    "}\n"
+    "void main() {\n"
+    "    base = gl_InstanceID * stride;\n"
+    "    int lineSpan = lineSides * 2 + 4;\n"
+    "    int vertex = gl_VertexID;\n"
+    "    int joint;\n"
+    "    int part;\n"
+    "    if (vertex < lines * lineSpan) {\n"
+    "        joint = vertex / lineSpan;\n"
+    "        vertex -= joint * lineSpan;\n"
+    "        joint = order[joint].x;\n"
+    "        part = vertex < lineSides ? 0 : (vertex < lineSides + 4 ? 1 : 2);\n"
+    "        vertex -= part == 0 ? 0 : (part == 1 ? lineSides : lineSides + 4);\n"
+    "    } else {\n"
+    "        vertex -= lines * lineSpan;\n"
+    "        joint = vertex / (headSides * 2);\n"
+    "        vertex -= joint * headSides * 2;\n"
+    "        joint = order[joint].y;\n"
+    "        part = vertex < headSides ? 3 : 4;\n"
+    "        vertex -= part == 3 ? 0 : headSides;\n"
+    "    }\n"
+    "    int color = int(value(3));\n"
+    "    int look = int(value(4));\n"
+    "    float prez = float((look >> 2) & 511);\n"
+    "    localAngles = (look & 2) != 0;\n"
+    "    shadeColor = vec4(float(color >> 16), float((color >> 8) & 255), float(color & 255), float(look >> 11)) / 255.0;\n"
+    "    vec2 position;\n"
+    "    bool drawn = false;\n"
+    "    vec2 start;\n"
+    "    float jointBearing;\n"
+    "    if (part < 3) {\n"
+    "        float radius = value(2) * 4.5;\n" // pen radius of renderStickJoints
+    "        bool tiny = radius * pixelScale < 0.75;\n" // TURTLE_LOD_STROKE
+    "        int sides = circleSides(prez, radius, lineSides);\n"
+    "        if (part != 0 || rig[joint].z == 1) {\n"
+    "            vec2 end = jointEnd(joint, start, jointBearing);\n"
+    "            bool connected = apart(start, end, radius);\n"
+    "            if (part == 0) {\n"
+    "                drawn = !tiny || !connected;\n"
+    "                position = circleVertex(start, radius, sides, vertex);\n"
+    "            } else if (part == 1) {\n"
+    "                if (connected) {\n"
+    "                    vec2 side = end - start;\n"
+    "                    vec2 offset = radius * vec2(-side.y, side.x) * inversesqrt(dot(side, side));\n"
+    "                    position = vertex == 0 ? start + offset : (vertex == 1 ? end + offset : (vertex == 2 ? end - offset : start - offset));\n" // corners of turtleQuadRender
+    "                    drawn = true;\n"
+    "                }\n"
+    "            } else {\n"
+    "                int next = rig[joint].w;\n"
+    "                bool nextConnected = next != -1 && apart(end, end + along(bearing(jointBearing, next), next), radius);\n"
+    "                drawn = !tiny || (!connected && !nextConnected);\n"
+    "                position = circleVertex(end, radius, sides, vertex);\n"
+    "            }\n"
+    "        }\n"
+    "    } else {\n"
+    "        float radius = rigShape[joint].y * value(2) * (part == 3 ? 1.0 : 0.8);\n"
+    "        int sides = circleSides(prez, radius, headSides);\n"
+    "        if (part == 3 || (look & 1) != 0) {\n"
+    "            drawn = true;\n"
+    "            position = circleVertex(jointEnd(joint, start, jointBearing), radius, sides, vertex);\n"
+    "            if (part == 4) {\n"
+    "                shadeColor = background;\n"
+    "            }\n"
+    "        }\n"
+    "    }\n"
+    "    gl_Position = drawn ? vec4(position * scale, 0.0, 1.0) : vec4(2.0, 2.0, 0.0, 1.0);\n"
+    "}\0";
+const char *stickShaderFragmentSource =
+    "#version 140\n"
+    "flat in vec4 shadeColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    fragColor = shadeColor;\n"
+    "}\0";
+
+/* compiles a shader, returns 0 and prints the log if it fails */
+uint32_t stickShaderCompile(uint32_t type, const char *source) {
+    uint32_t shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    int32_t success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char errorMessage[512];
+        glGetShaderInfoLog(shader, 512, NULL, errorMessage);
+        printf("stickShaderCompile: %s\n", errorMessage);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/* makes the shader for sticks of a rig, returns -1 if the GPU cannot run it */
+int32_t stickShaderInit(stick_shader_t *shader, stick_rig_t *rig) {
+    memset(shader, 0, sizeof(stick_shader_t));
+    if (!GLAD_GL_VERSION_3_1) {
+        return -1;
+    }
+    uint32_t vertexShader = stickShaderCompile(GL_VERTEX_SHADER, stickShaderVertexSource);
+    uint32_t fragmentShader = stickShaderCompile(GL_FRAGMENT_SHADER, stickShaderFragmentSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return -1;
+    }
+    shader -> program = glCreateProgram();
+    glAttachShader(shader -> program, vertexShader);
+    glAttachShader(shader -> program, fragmentShader);
+    glBindFragDataLocation(shader -> program, 0, "fragColor");
+    glLinkProgram(shader -> program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    int32_t success;
+    glGetProgramiv(shader -> program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char errorMessage[512];
+        glGetProgramInfoLog(shader -> program, 512, NULL, errorMessage);
+        printf("stickShaderInit: %s\n", errorMessage);
+        glDeleteProgram(shader -> program);
+        shader -> program = 0;
+        return -1;
+    }
+    shader -> joints = rig -> joints;
+    shader -> strideLocation = glGetUniformLocation(shader -> program, "stride");
+    shader -> lineSidesLocation = glGetUniformLocation(shader -> program, "lineSides");
+    shader -> headSidesLocation = glGetUniformLocation(shader -> program, "headSides");
+    shader -> scaleLocation = glGetUniformLocation(shader -> program, "scale");
+    shader -> pixelScaleLocation = glGetUniformLocation(shader -> program, "pixelScale");
+    shader -> backgroundLocation = glGetUniformLocation(shader -> program, "background");
+    /* the rig, with where renderStickJoints lifts the pen worked out once */
+    int32_t joints[STICK_MAX_JOINTS * 4];
+    float shape[STICK_MAX_JOINTS * 4];
+    int32_t order[STICK_MAX_JOINTS * 2];
+    memset(shape, 0, sizeof(shape));
+    memset(order, 0, sizeof(order));
+    int32_t penAt = -1;
+    int32_t lastLine = -1;
+    for (int32_t j = 0; j < rig -> joints; j++) {
+        joints[j * 4] = rig -> parent[j];
+        joints[j * 4 + 1] = rig -> draw[j];
+        joints[j * 4 + 2] = 0;
+        joints[j * 4 + 3] = -1;
+        shape[j * 4] = rig -> length[j];
+        shape[j * 4 + 1] = rig -> radius[j];
+        if (rig -> draw[j] == STICK_DRAW_CIRCLE) {
+            if (rig -> radius[j] > shader -> headRadius) {
+                shader -> headRadius = rig -> radius[j];
+            }
+            order[shader -> heads++ * 2 + 1] = j;
+        }
+        if (rig -> draw[j] != STICK_DRAW_LINE) {
+            continue;
+        }
+        order[shader -> lines++ * 2] = j;
+        int32_t start = rig -> parent[j] + 1;
+        if (penAt != start) {
+            joints[j * 4 + 2] = 1;
+        } else {
+            joints[lastLine * 4 + 3] = j;
+        }
+        penAt = j + 1;
+        lastLine = j;
+    }
+    glUseProgram(shader -> program);
+    glUniform1i(glGetUniformLocation(shader -> program, "sticks"), 0);
+    glUniform1i(glGetUniformLocation(shader -> program, "joints"), rig -> joints);
+    glUniform4iv(glGetUniformLocation(shader -> program, "rig"), rig -> joints, joints);
+    glUniform4fv(glGetUniformLocation(shader -> program, "rigShape"), rig -> joints, shape);
+    glUniform2iv(glGetUniformLocation(shader -> program, "order"), rig -> joints, order);
+    glUniform1i(glGetUniformLocation(shader -> program, "lines"), shader -> lines);
+    glUseProgram(0);
+    glGenVertexArrays(1, &shader -> vertexArray);
+    glGenBuffers(1, &shader -> buffer);
+    glGenTextures(1, &shader -> texture);
+    return 0;
+}
+
+/* values of a stick for turtleInstance: its style (STICK_SHADER_OPEN_HEAD and STICK_SHADER_LOCAL_ANGLES bits) and the angle of each joint (angles[j * stride], degrees, in the rig's angle space) */
+int32_t stickShaderValues(float *values, int32_t openHead, int32_t localAngles, const double *angles, int32_t stride, int32_t joints) {
+    values[0] = (openHead ? STICK_SHADER_OPEN_HEAD : 0) | (localAngles ? STICK_SHADER_LOCAL_ANGLES : 0);
+    for (int32_t j = 0; j < joints; j++) {
+        values[1 + j] = angles[j * stride];
+    }
+    return 1 + joints;
+}
+
+/* adds a fan of triangles (the same ones as turtleVertexFan) over sides vertices from first to indices, returns the new length */
+int32_t stickShaderFan(uint32_t *indices, int32_t length, uint32_t first, int32_t sides) {
+    for (int32_t i = 1; i + 1 < sides; i++) {
+        indices[length++] = first;
+        indices[length++] = first + i;
+        indices[length++] = first + i + 1;
+    }
+    return length;
+}
+
+/* index buffer of a stick whose circles have lineSides and headSides vertices, made the first time it is needed and kept for the next few (the shader's vertex array must be bound) */
+stick_shader_indices_t *stickShaderIndices(stick_shader_t *shader, int32_t lineSides, int32_t headSides) {
+    for (int32_t i = 0; i < STICK_SHADER_INDEX_BUFFERS; i++) {
+        if (shader -> indices[i].lineSides == lineSides && shader -> indices[i].headSides == headSides) {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shader -> indices[i].buffer);
+            return &shader -> indices[i];
+        }
+    }
+    stick_shader_indices_t *indices = &shader -> indices[shader -> indexEvict];
+    shader -> indexEvict = (shader -> indexEvict + 1) % STICK_SHADER_INDEX_BUFFERS;
+    if (indices -> buffer == 0) {
+        glGenBuffers(1, &indices -> buffer);
+    }
+    indices -> lineSides = lineSides;
+    indices -> headSides = headSides;
+    indices -> count = shader -> lines * ((lineSides - 2) * 6 + 6) + shader -> heads * (headSides - 2) * 6;
+    uint32_t *data = malloc(sizeof(uint32_t) * indices -> count);
+    int32_t length = 0;
+    uint32_t vertex = 0;
+    for (int32_t i = 0; i < shader -> lines; i++) {
+        length = stickShaderFan(data, length, vertex, lineSides);
+        vertex += lineSides;
+        uint32_t quad[6] = {0, 1, 2, 0, 2, 3}; // turtleQuadRender
+        for (int32_t corner = 0; corner < 6; corner++) {
+            data[length++] = vertex + quad[corner];
+        }
+        vertex += 4;
+        length = stickShaderFan(data, length, vertex, lineSides);
+        vertex += lineSides;
+    }
+    for (int32_t i = 0; i < shader -> heads * 2; i++) {
+        length = stickShaderFan(data, length, vertex, headSides);
+        vertex += headSides;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices -> buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * length, data, GL_STATIC_DRAW);
+    free(data);
+    return indices;
+}
+
+/* draws a run of sticks added with turtleInstance, registered with turtleInstanceRenderer */
+void stickShaderDraw(void *data, turtle_command_t *records, uint32_t length, double xfact, double yfact, double pixelScale) {
+    stick_shader_t *shader = data;
+    int32_t joints = shader -> joints;
+    int32_t stride = STICK_SHADER_HEADER + joints;
+    int32_t count = 0;
+    double biggest = 0; // size and circle precision of the biggest stick, every circle gets enough vertices for its circles
+    int32_t prez = 0;
+    for (uint32_t i = 0; i < length; i += 1 + records[i].reserved) {
+        turtle_command_t *command = &records[i];
+        if (command -> shape != TURTLE_BUFFER_INSTANCE || command -> reserved * 3 < 1 + joints || i + command -> reserved >= length) {
+            continue;
+        }
+        if (count >= shader -> capacity) {
+            shader -> capacity = shader -> capacity == 0 ? 64 : shader -> capacity * 2;
+            shader -> sticks = realloc(shader -> sticks, sizeof(float) * stride * shader -> capacity);
+        }
+        float *stick = shader -> sticks + count * stride;
+        stick[0] = command -> x;
+        stick[1] = command -> y;
+        stick[2] = command -> size;
+        stick[3] = command -> color[0] * 65536 + command -> color[1] * 256 + command -> color[2];
+        stick[4] = command -> color[3] * 2048 + command -> prez * 4 + (int32_t) records[i + 1].x;
+        /* payload records hold three values each in x, y and size, the style and then the angles */
+        for (int32_t j = 0; j < joints; j++) {
+            turtle_command_t *payload = &records[i + 1 + (j + 1) / 3];
+            int32_t field = (j + 1) % 3;
+            stick[STICK_SHADER_HEADER + j] = field == 0 ? payload -> x : (field == 1 ? payload -> y : payload -> size);
+        }
+        if (command -> size > biggest) {
+            biggest = command -> size;
+        }
+        if (command -> prez > prez) {
+            prez = command -> prez;
+        }
+        count++;
+    }
+    if (count == 0) {
+        return;
+    }
+    /* turtleCircleSides only grows with the radius and the precision */
+    int32_t lineSides = turtleCircleSides(prez, biggest * 9 * 0.5, pixelScale);
+    int32_t headSides = turtleCircleSides(prez, shader -> headRadius * biggest, pixelScale);
+    glUseProgram(shader -> program);
+    glUniform1i(shader -> strideLocation, stride);
+    glUniform1i(shader -> lineSidesLocation, lineSides);
+    glUniform1i(shader -> headSidesLocation, headSides);
+    glUniform2f(shader -> scaleLocation, xfact, yfact);
+    glUniform1f(shader -> pixelScaleLocation, pixelScale);
+    glUniform4f(shader -> backgroundLocation, turtleBufferChannel(turtle.bgr / 255) / 255.0, turtleBufferChannel(turtle.bgg / 255) / 255.0, turtleBufferChannel(turtle.bgb / 255) / 255.0, 0); // the background dot is opaque
+    glBindBuffer(GL_TEXTURE_BUFFER, shader -> buffer);
+    glBufferData(GL_TEXTURE_BUFFER, sizeof(float) * stride * count, shader -> sticks, GL_STREAM_DRAW);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_BUFFER, shader -> texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, shader -> buffer);
+    glBindVertexArray(shader -> vertexArray);
+    stick_shader_indices_t *indices = stickShaderIndices(shader, lineSides, headSides);
+    glDrawElementsInstanced(GL_TRIANGLES, indices -> count, GL_UNSIGNED_INT, (void *) 0, count);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glUseProgram(0);
+}
+
+void stickShaderFree(stick_shader_t *shader) {
+    if (shader -> program != 0) {
+        glDeleteProgram(shader -> program);
+        glDeleteVertexArrays(1, &shader -> vertexArray);
+        glDeleteBuffers(1, &shader -> buffer);
+        glDeleteTextures(1, &shader -> texture);
+        for (int32_t i = 0; i < STICK_SHADER_INDEX_BUFFERS; i++) {
+            glDeleteBuffers(1, &shader -> indices[i].buffer);
+        }
+    }
+    free(shader -> sticks);
+    memset(shader, 0, sizeof(stick_shader_t));
+}
+
+#endif
@@ -15,13 +15,19 @@ keyboard and mouse presses
 #include "glad.h"
 #include "glfw3.h"
 #include "list.h"
+#include "turtleBuffer.h"
+#include "turtleCircle.h"
 
-extern void glColor4d(double r, double g, double b, double a); // genius tactic to stop compiler warnings
-extern void glBegin(int type);
-extern void glVertex2d(double x, double y);
-extern void glEnd();
+#define TURTLE_LOD_STROKE 0.75 // pen radius (pixels) below which strokes are drawn without round caps and joins
 void turtleTexture(int textureCode, double x1, double y1, double x2, double y2, double rot, double r, double g, double b); // No support for textures in turtle.h, use turtleTextures.h
 
+/* a vertex of the triangles that a frame is tessellated into */
+typedef struct {
+    float x;
+    float y;
+    uint8_t color[4];
+} turtle_vertex_t;
+
 typedef struct {
     GLFWwindow* window; // the window
     list_t *keyPressed; // global keyPressed and mousePressed list
@@ -41,9 +47,11 @@ typedef struct {
     double mouseAbsY;
     double x; // x and y position of the turtle
     double y;
-    list_t *penPos; // a list of where to draw
-    uint64_t penHash; // the penPos list is hashed and this hash is used to determine if any changes occured between frames
-    uint32_t lastLength; // the penPos list's length is saved and if it is different from last frame we know we have to redraw
+    turtle_buffer_t *penPos; // packed records of where to draw
+    uint64_t penHash; // hash of the penPos buffer that was last drawn, if it is the same (and so is the length) nothing is drawn
+    uint32_t lastLength; // length of the penPos buffer that was last drawn
+    uint32_t events; // incremented by every input callback, if it hasn't changed then nothing happened since the last check
+    int8_t redraw; // forces the next turtleUpdate to redraw (window contents were damaged)
     uint8_t pen; // pen status (1 for down, 0 for up)
     uint16_t penshape; // 0 for circle, 1 for square, 2 for triangle
     uint8_t close; // close changes to 1 when the user clicks the x on the window
@@ -57,7 +65,25 @@ typedef struct {
     double bgr; // background color red
     double bgg; // background color green
     double bgb; // background color blue
-    double currentColor[4]; // for reducing API color calls
+    double currentColor[4]; // colour of the vertices being added (0 - 1)
+    uint8_t vertexColor[4]; // currentColor as it is stored in vertices
+    turtle_vertex_t *vertices; // every vertex of the frame
+    uint32_t vertexCount;
+    uint32_t vertexCapacity;
+    uint32_t *indices; // every triangle of the frame (3 indices into vertices each), drawn with one glDrawElements
+    uint32_t indexCount;
+    uint32_t indexCapacity;
+    void (*vertexSink)(void *data, turtle_vertex_t *vertices, uint32_t vertexCount, uint32_t *indices, uint32_t indexCount); // takes the triangles of the frame instead of OpenGL (NULL to draw them with OpenGL)
+    void *sinkData; // passed to vertexSink
+    uint32_t vertexProgram; // shader that draws the vertices (made by the first turtleVertexFlush that draws with OpenGL)
+    uint32_t vertexBuffer; // vertices and indices of the frame, kept between frames and only reallocated when a frame is bigger than any before it
+    uint32_t indexBuffer;
+    uint32_t vertexBufferSize; // bytes allocated for vertexBuffer
+    uint32_t indexBufferSize;
+    void (*instanceRenderer)(void *data, turtle_command_t *records, uint32_t length, double xfact, double yfact, double pixelScale); // draws runs of TURTLE_BUFFER_INSTANCE records (NULL to skip them)
+    void *instanceData; // passed to instanceRenderer
+    float *normals; // positions of the records and unit normals of the segments between them (four arrays), filled in a batch before a frame is drawn
+    uint32_t normalCapacity;
 
     /* 3D variables */
     double cameraX;
@@ -83,6 +109,7 @@ void turtleSetWorldCoordinates(int32_t minX, int32_t minY, int32_t maxX, int32_t
 
 /* detect character */
 void unicodeSense(GLFWwindow *window, uint32_t codepoint) {
+    turtle.events++;
     if (turtle.unicodeCallback != NULL) {
         turtle.unicodeCallback(codepoint);
     }
@@ -90,6 +117,7 @@ void unicodeSense(GLFWwindow *window, uint32_t codepoint) {
 
 /* detect key presses */
 void keySense(GLFWwindow* window, int32_t key, int32_t scancode, int32_t action, int32_t mods) {
+    turtle.events++;
     if (turtle.keyCallback != NULL) {
         turtle.keyCallback(key, scancode, action);
     }
@@ -103,6 +131,7 @@ void keySense(GLFWwindow* window, int32_t key, int32_t scancode, int32_t action,
 
 /* detect mouse clicks */
 void mouseSense(GLFWwindow *window, int32_t button, int32_t action, int32_t mods) {
+    turtle.events++;
     if (action == GLFW_PRESS) {
         switch(button) {
         case GLFW_MOUSE_BUTTON_LEFT:
@@ -143,9 +172,21 @@ void mouseSense(GLFWwindow *window, int32_t button, int32_t action, int32_t mods
 
 /* detect scroll wheel */
 void scrollSense(GLFWwindow* window, double xoffset, double yoffset) {
+    turtle.events++;
     turtle.scrollY = yoffset;
 }
 
+/* detect mouse movement */
+void cursorSense(GLFWwindow *window, double x, double y) {
+    turtle.events++;
+}
+
+/* detect when the window needs to be redrawn (uncovered, resized) */
+void refreshSense(GLFWwindow *window) {
+    turtle.events++;
+    turtle.redraw = 1;
+}
+
 /* the behavior with the mouse wheel is different since it can't be "on" or "off" */
 double turtleMouseWheel() {
     double temp = turtle.scrollY;
@@ -178,23 +219,19 @@ int8_t turtleMouseMid() {
     return turtle.mousePressed[2];
 }
 
-/* initializes the turtletools module */
-void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
-    gladLoadGL();
-    glfwMakeContextCurrent(window); // various glfw things
-    glEnable(GL_ALPHA);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
-    glClearColor(1.0, 1.0, 1.0, 0.0); // white background by default
+/* sets every turtle variable to its default */
+void turtleInitState(GLFWwindow *window) {
     turtle.window = window;
     turtle.close = 0;
     turtle.shouldClose = 0;
     turtle.keyPressed = list_init();
     turtle.lastscreenbounds[0] = 0;
     turtle.lastscreenbounds[1] = 0;
-    turtle.penPos = list_init();
+    turtle.penPos = turtleBufferInit();
     turtle.penHash = 0;
     turtle.lastLength = 0;
+    turtle.events = 0;
+    turtle.redraw = 0;
     turtle.x = 0;
     turtle.y = 0;
     turtle.pensize = 1;
@@ -212,6 +249,27 @@ void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, in
         turtle.currentColor[i] = 0.0;
     }
     turtle.currentColor[3] = 1.0;
+    for (uint8_t i = 0; i < 3; i++) {
+        turtle.vertexColor[i] = 0;
+    }
+    turtle.vertexColor[3] = 255;
+    turtle.vertexCount = 0;
+    turtle.vertexCapacity = 0;
+    turtle.vertices = NULL;
+    turtle.indexCount = 0;
+    turtle.indexCapacity = 0;
+    turtle.indices = NULL;
+    turtle.normalCapacity = 0;
+    turtle.normals = NULL;
+    turtle.vertexSink = NULL;
+    turtle.sinkData = NULL;
+    turtle.vertexProgram = 0;
+    turtle.vertexBuffer = 0;
+    turtle.indexBuffer = 0;
+    turtle.vertexBufferSize = 0;
+    turtle.indexBufferSize = 0;
+    turtle.instanceRenderer = NULL;
+    turtle.instanceData = NULL;
     /* 3D variables */
     turtle.cameraX = 0;
     turtle.cameraY = 0;
@@ -219,14 +277,39 @@ void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, in
     turtle.cameraFOV = 90;
     turtle.cameraDirectionLeftRight = 0;
     turtle.cameraDirectionUpDown = 0;
-
-    turtleSetWorldCoordinates(minX, minY, maxX, maxY);
     turtle.keyCallback = NULL;
     turtle.unicodeCallback = NULL;
+}
+
+/* initializes the turtletools module */
+void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
+    gladLoadGL();
+    glfwMakeContextCurrent(window); // various glfw things
+    glEnable(GL_ALPHA);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+    glClearColor(1.0, 1.0, 1.0, 0.0); // white background by default
+    turtleInitState(window);
+    turtleSetWorldCoordinates(minX, minY, maxX, maxY);
     glfwSetCharCallback(window, unicodeSense);
     glfwSetKeyCallback(window, keySense); // initiate mouse and keyboard detection
     glfwSetMouseButtonCallback(window, mouseSense);
     glfwSetScrollCallback(window, scrollSense);
+    glfwSetCursorPosCallback(window, cursorSense);
+    glfwSetWindowRefreshCallback(window, refreshSense);
+}
+
+/* initializes the turtle without a window or OpenGL context, the turtle's path can then only be drawn with turtleTessellate (see turtleRaster.h), width and height are the pixels that the coordinates are drawn to */
+void turtleInitHeadless(int32_t width, int32_t height, int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
+    turtleInitState(NULL);
+    turtle.screenbounds[0] = width;
+    turtle.screenbounds[1] = height;
+    turtle.initscreenbounds[0] = width;
+    turtle.initscreenbounds[1] = height;
+    turtle.bounds[0] = minX;
+    turtle.bounds[1] = minY;
+    turtle.bounds[2] = maxX;
+    turtle.bounds[3] = maxY;
 }
 
 /* gets the mouse coordinates */
@@ -252,7 +335,9 @@ void turtleBgColor(double r, double g, double b) {
     turtle.bgr = r;
     turtle.bgg = g;
     turtle.bgb = b;
-    glClearColor(r / 255, g / 255, b / 255, 0.0);
+    if (turtle.window != NULL) {
+        glClearColor(r / 255, g / 255, b / 255, 0.0);
+    }
 }
 
 /* set the pen color */
@@ -278,42 +363,36 @@ void turtlePenSize(double size) {
 
 /* clears all the pen drawings */
 void turtleClear() {
-    // list_free(turtle.penPos);
-    // turtle.penPos = list_init();
-    turtle.penPos -> length = 0; // could be dangerous
+    turtleBufferClear(turtle.penPos);
+}
+
+/* adds the pen at (x, y) to penPos, unless the last record is the same */
+void turtlePushPen(double x, double y) {
+    turtle_command_t pen;
+    pen.x = x;
+    pen.y = y;
+    pen.size = turtle.pensize;
+    pen.color[0] = turtleBufferChannel(turtle.penr);
+    pen.color[1] = turtleBufferChannel(turtle.peng);
+    pen.color[2] = turtleBufferChannel(turtle.penb);
+    pen.color[3] = turtleBufferChannel(turtle.pena);
+    pen.shape = turtle.penshape;
+    pen.prez = turtle.circleprez + 0.5;
+    pen.reserved = 0;
+    if (turtle.penPos -> length > 0) {
+        turtle_command_t *last = &turtle.penPos -> data[turtle.penPos -> length - 1];
+        if (last -> x == pen.x && last -> y == pen.y && last -> size == pen.size && memcmp(last -> color, pen.color, 4) == 0 && last -> shape == pen.shape && last -> prez == pen.prez) {
+            return;
+        }
+    }
+    turtleBufferAdd(turtle.penPos, &pen);
 }
 
 /* pen down */
 void turtlePenDown() {
     if (turtle.pen == 0) {
         turtle.pen = 1;
-        int8_t changed = 0;
-        int32_t len = turtle.penPos -> length;
-        if (len > 0) {
-            unitype *ren = turtle.penPos -> data;
-            if (ren[len - 9].d != turtle.x) {changed = 1;}
-            if (ren[len - 8].d != turtle.y) {changed = 1;}
-            if (ren[len - 7].d != turtle.pensize) {changed = 1;}
-            if (ren[len - 6].d != turtle.penr) {changed = 1;}
-            if (ren[len - 5].d != turtle.peng) {changed = 1;}
-            if (ren[len - 4].d != turtle.penb) {changed = 1;}
-            if (ren[len - 3].d != turtle.pena) {changed = 1;}
-            if (ren[len - 2].h != turtle.penshape) {changed = 1;}
-            if (ren[len - 1].d != turtle.circleprez) {changed = 1;}
-        } else {
-            changed = 1;
-        }
-        if (changed == 1) {
-            list_append(turtle.penPos, (unitype) turtle.x, 'd');
-            list_append(turtle.penPos, (unitype) turtle.y, 'd');
-            list_append(turtle.penPos, (unitype) turtle.pensize, 'd');
-            list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-            list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-            list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-            list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-            list_append(turtle.penPos, (unitype) turtle.penshape, 'h');
-            list_append(turtle.penPos, (unitype) turtle.circleprez, 'd');
-        }
+        turtlePushPen(turtle.x, turtle.y);
     }
 }
 
@@ -321,17 +400,7 @@ void turtlePenDown() {
 void turtlePenUp() {
     if (turtle.pen == 1) {
         turtle.pen = 0;
-        if (turtle.penPos -> length > 0 && turtle.penPos -> type[turtle.penPos -> length - 1] != 'c') {
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-            list_append(turtle.penPos, (unitype) 0, 'c');
-        }
+        turtleBufferBreak(turtle.penPos);
     }
 }
 
@@ -368,292 +437,288 @@ void turtleGoto(double x, double y) {
         turtle.x = x;
         turtle.y = y;
         if (turtle.pen == 1) {
-            int8_t changed = 0;
-            int32_t len = turtle.penPos -> length;
-            if (len > 0) {
-                unitype *ren = turtle.penPos -> data;
-                if (ren[len - 9].d != turtle.x) {changed = 1;}
-                if (ren[len - 8].d != turtle.y) {changed = 1;}
-                if (ren[len - 7].d != turtle.pensize) {changed = 1;}
-                if (ren[len - 6].d != turtle.penr) {changed = 1;}
-                if (ren[len - 5].d != turtle.peng) {changed = 1;}
-                if (ren[len - 4].d != turtle.penb) {changed = 1;}
-                if (ren[len - 3].d != turtle.pena) {changed = 1;}
-                if (ren[len - 2].h != turtle.penshape) {changed = 1;}
-                if (ren[len - 1].d != turtle.circleprez) {changed = 1;}
-            } else {
-                changed = 1;
-            }
-            if (changed == 1) {
-                list_append(turtle.penPos, (unitype) x, 'd');
-                list_append(turtle.penPos, (unitype) y, 'd');
-                list_append(turtle.penPos, (unitype) turtle.pensize, 'd');
-                list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-                list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-                list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-                list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-                list_append(turtle.penPos, (unitype) turtle.penshape, 'h');
-                list_append(turtle.penPos, (unitype) turtle.circleprez, 'd');
-            }
+            turtlePushPen(x, y);
         }
     }
 }
 
-/* draws a circle at the specified x and y (coordinates) */
-void turtleCircleRender(double x, double y, double rad, double r, double g, double b, double a, double xfact, double yfact, double prez) {
-    int8_t colorChange = 0;
-    if (r != turtle.currentColor[0]) {colorChange = 1;}
-    if (g != turtle.currentColor[1]) {colorChange = 1;}
-    if (b != turtle.currentColor[2]) {colorChange = 1;}
-    if (a != turtle.currentColor[3]) {colorChange = 1;}
-    if (colorChange == 1) {
-        glColor4d(r, g, b, a);
+/* sets the colour of the vertices that are added next */
+void turtleVertexColor(double r, double g, double b, double a) {
+    if (r != turtle.currentColor[0] || g != turtle.currentColor[1] || b != turtle.currentColor[2] || a != turtle.currentColor[3]) {
         turtle.currentColor[0] = r;
         turtle.currentColor[1] = g;
         turtle.currentColor[2] = b;
         turtle.currentColor[3] = a;
+        turtle.vertexColor[0] = turtleBufferChannel(r);
+        turtle.vertexColor[1] = turtleBufferChannel(g);
+        turtle.vertexColor[2] = turtleBufferChannel(b);
+        turtle.vertexColor[3] = turtleBufferChannel(a);
+    }
+}
+
+/* make room for vertices more vertices and triangles more triangles */
+void turtleVertexReserve(uint32_t vertices, uint32_t triangles) {
+    if (turtle.vertexCount + vertices > turtle.vertexCapacity) {
+        if (turtle.vertexCapacity == 0) {
+            turtle.vertexCapacity = 4096;
+        }
+        while (turtle.vertexCount + vertices > turtle.vertexCapacity) {
+            turtle.vertexCapacity *= 2;
+        }
+        turtle.vertices = realloc(turtle.vertices, sizeof(turtle_vertex_t) * turtle.vertexCapacity);
     }
-    glBegin(GL_TRIANGLE_FAN);
-    for (double i = 0; i < prez; i++) {
-        glVertex2d((x + rad * sin(2 * i * M_PI / prez)) * xfact, (y + rad * cos(2 * i * M_PI / prez)) * yfact);
+    if (turtle.indexCount + triangles * 3 > turtle.indexCapacity) {
+        if (turtle.indexCapacity == 0) {
+            turtle.indexCapacity = 4096;
+        }
+        while (turtle.indexCount + triangles * 3 > turtle.indexCapacity) {
+            turtle.indexCapacity *= 2;
+        }
+        turtle.indices = realloc(turtle.indices, sizeof(uint32_t) * turtle.indexCapacity);
     }
-    glEnd();
+}
+
+/* adds a vertex (coordinates already scaled to -1 to 1), turtleVertexReserve must have made room for it */
+void turtleVertex(double x, double y) {
+    turtle_vertex_t *vertex = &turtle.vertices[turtle.vertexCount++];
+    vertex -> x = x;
+    vertex -> y = y;
+    memcpy(vertex -> color, turtle.vertexColor, 4);
+}
+
+/* adds the triangles of a fan over the last count vertices, turtleVertexReserve must have made room for them */
+void turtleVertexFan(uint32_t count) {
+    uint32_t first = turtle.vertexCount - count;
+    for (uint32_t i = first + 1; i + 1 < turtle.vertexCount; i++) {
+        turtle.indices[turtle.indexCount++] = first;
+        turtle.indices[turtle.indexCount++] = i;
+        turtle.indices[turtle.indexCount++] = i + 1;
+    }
+}
+
+/* draws a circle at the specified x and y (coordinates) with sides sides (see turtleCircleSides) */
+void turtleCircleRender(double x, double y, double rad, double r, double g, double b, double a, double xfact, double yfact, int32_t sides) {
+    turtleVertexColor(r, g, b, a);
+    if (sides < 3 || sides > TURTLE_CIRCLE_MAX_SIDES) {
+        return;
+    }
+    const float *unit = turtleCircleUnit(sides);
+    turtleVertexReserve(sides, sides - 2);
+    for (int32_t i = 0; i < sides; i++) {
+        turtleVertex((x + rad * unit[i * 2]) * xfact, (y + rad * unit[i * 2 + 1]) * yfact);
+    }
+    turtleVertexFan(sides);
 }
 
 /* draws a square */
 void turtleSquareRender(double x1, double y1, double x2, double y2, double r, double g, double b, double a, double xfact, double yfact) {
-    int8_t colorChange = 0;
-    if (r != turtle.currentColor[0]) {colorChange = 1;}
-    if (g != turtle.currentColor[1]) {colorChange = 1;}
-    if (b != turtle.currentColor[2]) {colorChange = 1;}
-    if (a != turtle.currentColor[3]) {colorChange = 1;}
-    if (colorChange == 1) {
-        glColor4d(r, g, b, a);
-        turtle.currentColor[0] = r;
-        turtle.currentColor[1] = g;
-        turtle.currentColor[2] = b;
-        turtle.currentColor[3] = a;
-    }
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2d(x1 * xfact, y1 * yfact);
-    glVertex2d(x2 * xfact, y1 * yfact);
-    glVertex2d(x2 * xfact, y2 * yfact);
-    glVertex2d(x1 * xfact, y2 * yfact);
-    glEnd();
+    turtleVertexColor(r, g, b, a);
+    turtleVertexReserve(4, 2);
+    turtleVertex(x1 * xfact, y1 * yfact);
+    turtleVertex(x2 * xfact, y1 * yfact);
+    turtleVertex(x2 * xfact, y2 * yfact);
+    turtleVertex(x1 * xfact, y2 * yfact);
+    turtleVertexFan(4);
 }
 
 /* draws a triangle */
 void turtleTriangleRender(double x1, double y1, double x2, double y2, double x3, double y3, double r, double g, double b, double a, double xfact, double yfact) {
-    int8_t colorChange = 0;
-    if (r != turtle.currentColor[0]) {colorChange = 1;}
-    if (g != turtle.currentColor[1]) {colorChange = 1;}
-    if (b != turtle.currentColor[2]) {colorChange = 1;}
-    if (a != turtle.currentColor[3]) {colorChange = 1;}
-    if (colorChange == 1) {
-        glColor4d(r, g, b, a);
-        turtle.currentColor[0] = r;
-        turtle.currentColor[1] = g;
-        turtle.currentColor[2] = b;
-        turtle.currentColor[3] = a;
-    }
-    glBegin(GL_TRIANGLES);
-    glVertex2d(x1 * xfact, y1 * yfact);
-    glVertex2d(x2 * xfact, y2 * yfact);
-    glVertex2d(x3 * xfact, y3 * yfact);
-    glEnd();
+    turtleVertexColor(r, g, b, a);
+    turtleVertexReserve(3, 1);
+    turtleVertex(x1 * xfact, y1 * yfact);
+    turtleVertex(x2 * xfact, y2 * yfact);
+    turtleVertex(x3 * xfact, y3 * yfact);
+    turtleVertexFan(3);
 }
 
 /* draws a quadrilateral */
 void turtleQuadRender(double x1, double y1, double x2, double y2, double x3, double y3, double x4, double y4, double r, double g, double b, double a, double xfact, double yfact) {
-    int8_t colorChange = 0;
-    if (r != turtle.currentColor[0]) {colorChange = 1;}
-    if (g != turtle.currentColor[1]) {colorChange = 1;}
-    if (b != turtle.currentColor[2]) {colorChange = 1;}
-    if (a != turtle.currentColor[3]) {colorChange = 1;}
-    if (colorChange == 1) {
-        glColor4d(r, g, b, a);
-        turtle.currentColor[0] = r;
-        turtle.currentColor[1] = g;
-        turtle.currentColor[2] = b;
-        turtle.currentColor[3] = a;
+    turtleVertexColor(r, g, b, a);
+    turtleVertexReserve(4, 2);
+    turtleVertex(x1 * xfact, y1 * yfact);
+    turtleVertex(x2 * xfact, y2 * yfact);
+    turtleVertex(x3 * xfact, y3 * yfact);
+    turtleVertex(x4 * xfact, y4 * yfact);
+    turtleVertexFan(4);
+}
+
+/* vertices are already in normalised device coordinates */
+const char *turtleVertexShaderSource =
+    "#version 110\n"
+    "attribute vec2 position;\n"
+    "attribute vec4 color;\n"
+    "varying vec4 vertexColor;\n"
+    "void main() {\n"
+    "    gl_Position = vec4(position, 0.0, 1.0);\n"
+    "    vertexColor = color;\n"
+    "}\n";
+
+const char *turtleFragmentShaderSource =
+    "#version 110\n"
+    "varying vec4 vertexColor;\n"
+    "void main() {\n"
+    "    gl_FragColor = vertexColor;\n"
+    "}\n";
+
+/* makes the shader and buffers that turtleVertexFlush draws with */
+void turtleVertexProgramInit() {
+    uint32_t shaders[2] = {glCreateShader(GL_VERTEX_SHADER), glCreateShader(GL_FRAGMENT_SHADER)};
+    glShaderSource(shaders[0], 1, &turtleVertexShaderSource, NULL);
+    glShaderSource(shaders[1], 1, &turtleFragmentShaderSource, NULL);
+    turtle.vertexProgram = glCreateProgram();
+    for (int32_t i = 0; i < 2; i++) {
+        glCompileShader(shaders[i]);
+        glAttachShader(turtle.vertexProgram, shaders[i]);
+    }
+    glBindAttribLocation(turtle.vertexProgram, 0, "position");
+    glBindAttribLocation(turtle.vertexProgram, 1, "color");
+    glLinkProgram(turtle.vertexProgram);
+    int32_t success;
+    glGetProgramiv(turtle.vertexProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        char errorMessage[512];
+        glGetProgramInfoLog(turtle.vertexProgram, 512, NULL, errorMessage);
+        printf("turtleVertexProgramInit: %s\n", errorMessage);
+    }
+    for (int32_t i = 0; i < 2; i++) {
+        glDeleteShader(shaders[i]);
+    }
+    glGenBuffers(1, &turtle.vertexBuffer);
+    glGenBuffers(1, &turtle.indexBuffer);
+}
+
+/* copies data into a buffer object, growing it if it is too small */
+void turtleVertexUpload(uint32_t target, uint32_t *size, const void *data, uint32_t bytes) {
+    if (bytes > *size) {
+        *size = bytes * 2;
+        glBufferData(target, *size, NULL, GL_DYNAMIC_DRAW);
+    }
+    glBufferSubData(target, 0, bytes, data);
+}
+
+/* submits the vertices of the frame in one draw call (or gives them to turtle.vertexSink) */
+void turtleVertexFlush() {
+    if (turtle.vertexSink != NULL) {
+        if (turtle.indexCount > 0) {
+            turtle.vertexSink(turtle.sinkData, turtle.vertices, turtle.vertexCount, turtle.indices, turtle.indexCount);
+        }
+    } else if (turtle.vertexCount > 0) {
+        if (turtle.vertexProgram == 0) {
+            turtleVertexProgramInit();
+        }
+        glUseProgram(turtle.vertexProgram);
+        glBindBuffer(GL_ARRAY_BUFFER, turtle.vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, turtle.indexBuffer);
+        turtleVertexUpload(GL_ARRAY_BUFFER, &turtle.vertexBufferSize, turtle.vertices, turtle.vertexCount * sizeof(turtle_vertex_t));
+        turtleVertexUpload(GL_ELEMENT_ARRAY_BUFFER, &turtle.indexBufferSize, turtle.indices, turtle.indexCount * sizeof(uint32_t));
+        glEnableVertexAttribArray(0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(turtle_vertex_t), (void *) 0);
+        glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(turtle_vertex_t), (void *) (2 * sizeof(float)));
+        glDrawElements(GL_TRIANGLES, turtle.indexCount, GL_UNSIGNED_INT, (void *) 0);
+        glDisableVertexAttribArray(1);
+        glDisableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glUseProgram(0);
     }
-    glBegin(GL_TRIANGLE_FAN);
-    glVertex2d(x1 * xfact, y1 * yfact);
-    glVertex2d(x2 * xfact, y2 * yfact);
-    glVertex2d(x3 * xfact, y3 * yfact);
-    glVertex2d(x4 * xfact, y4 * yfact);
-    glEnd();
+    turtle.vertexCount = 0;
+    turtle.indexCount = 0;
+}
+
+/* adds one vertex of a blit shape to the pipeline, colour is 0 - 1 */
+void turtlePushVertex(double x, double y, double size, double r, double g, double b, double a, uint8_t shape) {
+    turtle_command_t command;
+    command.x = x;
+    command.y = y;
+    command.size = size;
+    command.color[0] = turtleBufferChannel(r);
+    command.color[1] = turtleBufferChannel(g);
+    command.color[2] = turtleBufferChannel(b);
+    command.color[3] = turtleBufferChannel(a);
+    command.shape = shape;
+    command.prez = turtle.circleprez + 0.5;
+    command.reserved = 0;
+    turtleBufferAdd(turtle.penPos, &command);
 }
 
 /* adds a (blit) triangle to the pipeline (for better speed) */
 void turtleTriangle(double x1, double y1, double x2, double y2, double x3, double y3) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 66, 'h'); // blit triangle signifier
-    list_append(turtle.penPos, (unitype) y2, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x3, 'd');
-    list_append(turtle.penPos, (unitype) y3, 'd');
-    list_append(turtle.penPos, (unitype) 0, 'd'); // zero'd out (wasted space)
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 66, 'h'); // blit triangle signifier
-    list_append(turtle.penPos, (unitype) 0, 'd'); // zero'd out (wasted space)
+    turtlePushVertex(x1, y1, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE);
+    turtlePushVertex(x2, y2, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE);
+    turtlePushVertex(x3, y3, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE);
 }
 
 void turtleTriangleColor(double x1, double y1, double x2, double y2, double x3, double y3, double r, double g, double b, double a) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) (r / 255), 'd');
-    list_append(turtle.penPos, (unitype) (g / 255), 'd');
-    list_append(turtle.penPos, (unitype) (b / 255), 'd');
-    list_append(turtle.penPos, (unitype) (a / 255), 'd');
-    list_append(turtle.penPos, (unitype) 66, 'h'); // blit triangle signifier
-    list_append(turtle.penPos, (unitype) y2, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x3, 'd');
-    list_append(turtle.penPos, (unitype) y3, 'd');
-    list_append(turtle.penPos, (unitype) 0, 'd'); // zero'd out (wasted space)
-    list_append(turtle.penPos, (unitype) r, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) g, 'd');
-    list_append(turtle.penPos, (unitype) b, 'd');
-    list_append(turtle.penPos, (unitype) a, 'd');
-    list_append(turtle.penPos, (unitype) 66, 'h'); // blit triangle signifier
-    list_append(turtle.penPos, (unitype) 0, 'd'); // zero'd out (wasted space)
+    turtlePushVertex(x1, y1, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_TRIANGLE);
+    turtlePushVertex(x2, y2, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_TRIANGLE);
+    turtlePushVertex(x3, y3, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_TRIANGLE);
 }
 
 /* adds a (blit) quad to the pipeline (for better speed) */
 void turtleQuad(double x1, double y1, double x2, double y2, double x3, double y3, double x4, double y4) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y2, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x3, 'd');
-    list_append(turtle.penPos, (unitype) y3, 'd');
-    list_append(turtle.penPos, (unitype) x4, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y4, 'd');
+    turtlePushVertex(x1, y1, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x2, y2, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x3, y3, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x4, y4, 0, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_QUAD);
 }
 
 void turtleQuadColor(double x1, double y1, double x2, double y2, double x3, double y3, double x4, double y4, double r, double g, double b, double a) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) (r / 255), 'd');
-    list_append(turtle.penPos, (unitype) (g / 255), 'd');
-    list_append(turtle.penPos, (unitype) (b / 255), 'd');
-    list_append(turtle.penPos, (unitype) (a / 255), 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y2, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x3, 'd');
-    list_append(turtle.penPos, (unitype) y3, 'd');
-    list_append(turtle.penPos, (unitype) x4, 'd');
-    list_append(turtle.penPos, (unitype) r, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) g, 'd');
-    list_append(turtle.penPos, (unitype) b, 'd');
-    list_append(turtle.penPos, (unitype) a, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y4, 'd');
+    turtlePushVertex(x1, y1, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x2, y2, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x3, y3, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_QUAD);
+    turtlePushVertex(x4, y4, 0, r / 255, g / 255, b / 255, a / 255, TURTLE_BUFFER_QUAD);
 }
 
 /* adds a (blit) rectangle to the pipeline (uses quad interface) */
 void turtleRectangle(double x1, double y1, double x2, double y2) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y1, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) y2, 'd');
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y2, 'd');
+    turtleQuad(x1, y1, x2, y1, x2, y2, x1, y2);
 }
 
 void turtleRectangleColor(double x1, double y1, double x2, double y2, double r, double g, double b, double a) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) (r / 255), 'd');
-    list_append(turtle.penPos, (unitype) (g / 255), 'd');
-    list_append(turtle.penPos, (unitype) (b / 255), 'd');
-    list_append(turtle.penPos, (unitype) (a / 255), 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y1, 'd'); // some unconventional formatting but it works
-
-    list_append(turtle.penPos, (unitype) x2, 'd');
-    list_append(turtle.penPos, (unitype) y2, 'd');
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) r, 'd'); // duplicate colour data (wasted space)
-    list_append(turtle.penPos, (unitype) g, 'd');
-    list_append(turtle.penPos, (unitype) b, 'd');
-    list_append(turtle.penPos, (unitype) a, 'd');
-    list_append(turtle.penPos, (unitype) 67, 'h'); // blit quad signifier
-    list_append(turtle.penPos, (unitype) y2, 'd');
+    turtleQuadColor(x1, y1, x2, y1, x2, y2, x1, y2, r, g, b, a);
 }
 
 /* adds a (blit) circle to the pipeline */
 void turtleCircle(double x, double y, double radius) {
-    list_append(turtle.penPos, (unitype) x, 'd');
-    list_append(turtle.penPos, (unitype) y, 'd');
-    list_append(turtle.penPos, (unitype) radius, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 64, 'h'); // blit circle signifier
-    list_append(turtle.penPos, (unitype) turtle.circleprez, 'd');
+    turtlePushVertex(x, y, radius, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_CIRCLE);
+}
+
+/* adds an instance at (x, y) with the pen's colour and count values, it is drawn by turtle.instanceRenderer along with the instances next to it */
+void turtleInstance(double x, double y, double size, const float *values, int32_t count) {
+    turtle_command_t command;
+    command.x = x;
+    command.y = y;
+    command.size = size;
+    command.color[0] = turtleBufferChannel(turtle.penr);
+    command.color[1] = turtleBufferChannel(turtle.peng);
+    command.color[2] = turtleBufferChannel(turtle.penb);
+    command.color[3] = turtleBufferChannel(turtle.pena);
+    command.shape = TURTLE_BUFFER_INSTANCE;
+    command.prez = turtle.circleprez + 0.5;
+    command.reserved = (count + 2) / 3;
+    turtleBufferAdd(turtle.penPos, &command);
+    memset(&command, 0, sizeof(turtle_command_t));
+    command.shape = TURTLE_BUFFER_PAYLOAD;
+    for (int32_t i = 0; i < count; i += 3) {
+        command.x = values[i];
+        command.y = i + 1 < count ? values[i + 1] : 0;
+        command.size = i + 2 < count ? values[i + 2] : 0;
+        turtleBufferAdd(turtle.penPos, &command);
+    }
+}
+
+/* sets the function that draws instances (see turtleInstance), it is given each run of instance records in the order they were added and must leave no program, vertex array or buffer bound */
+void turtleInstanceRenderer(void (*renderer)(void *data, turtle_command_t *records, uint32_t length, double xfact, double yfact, double pixelScale), void *data) {
+    turtle.instanceRenderer = renderer;
+    turtle.instanceData = data;
 }
 
 /* create a triangle in 3D */
 void turtle3DTriangle(double x1, double y1, double z1, double x2, double y2, double z2, double x3, double y3, double z3) {
-    list_append(turtle.penPos, (unitype) x1, 'd');
-    list_append(turtle.penPos, (unitype) y1, 'd');
-    list_append(turtle.penPos, (unitype) z1, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penr, 'd');
-    list_append(turtle.penPos, (unitype) turtle.peng, 'd');
-    list_append(turtle.penPos, (unitype) turtle.penb, 'd');
-    list_append(turtle.penPos, (unitype) turtle.pena, 'd');
-    list_append(turtle.penPos, (unitype) 130, 'h'); // blit 3D triangle signifier
-    list_append(turtle.penPos, (unitype) x2, 'd');
-
-    list_append(turtle.penPos, (unitype) y2, 'd');
-    list_append(turtle.penPos, (unitype) z2, 'd');
-    list_append(turtle.penPos, (unitype) x3, 'd');
-    list_append(turtle.penPos, (unitype) y3, 'd');
-    list_append(turtle.penPos, (unitype) z3, 'd');
-    list_append(turtle.penPos, (unitype) 0, 'd');
-    list_append(turtle.penPos, (unitype) 0, 'd');
-    list_append(turtle.penPos, (unitype) 130, 'h'); // blit 3D triangle signifier
-    list_append(turtle.penPos, (unitype) 0, 'd');
+    turtlePushVertex(x1, y1, z1, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE_3D);
+    turtlePushVertex(x2, y2, z2, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE_3D);
+    turtlePushVertex(x3, y3, z3, turtle.penr, turtle.peng, turtle.penb, turtle.pena, TURTLE_BUFFER_TRIANGLE_3D);
 }
 
 /* 3D -> 2D using perspective projection matrix */
@@ -695,126 +760,174 @@ void turtlePerspective(double x, double y, double z, double *xOut, double *yOut)
     // printf("%lf %lf\n", *xOut, *yOut);
 }
 
-/* draws the turtle's path on the screen */
-void turtleUpdate() {
-    /* used to have a feature that only redrew the screen if there have been any changes from last frame, but it has been removed.
-       opted to redraw every frame and not list_copy, an alternative is hashing the penPos list. An interesting idea for sure... for another time */
-    int8_t changed = 0;
+/* unit normals (left of the direction of travel) of the segments between count + 1 points, zero for segments with no length
+the inverse square root is a bit trick refined by three newton steps (to float precision) instead of sqrtf, which can set errno and so stops the loop from being vectorised */
+void turtleStrokeNormals(int32_t count, const float *restrict x, const float *restrict y, float *restrict normalX, float *restrict normalY) {
+    for (int32_t i = 0; i < count; i++) {
+        float dx = x[i + 1] - x[i];
+        float dy = y[i + 1] - y[i];
+        float lengthSquared = dx * dx + dy * dy;
+        union {float f; uint32_t u;} guess = {lengthSquared};
+        guess.u = 0x5F375A86 - (guess.u >> 1);
+        float inverse = guess.f; // finite even when lengthSquared is 0, so a segment with no length gets a zero normal
+        inverse *= 1.5f - 0.5f * lengthSquared * inverse * inverse;
+        inverse *= 1.5f - 0.5f * lengthSquared * inverse * inverse;
+        inverse *= 1.5f - 0.5f * lengthSquared * inverse * inverse;
+        normalX[i] = -dy * inverse;
+        normalY[i] = dx * inverse;
+    }
+}
+
+/* turns the turtle's path into triangles for a target of width by height pixels and flushes them (see turtleVertexFlush), instances are only drawn when the triangles go to OpenGL */
+void turtleTessellate(int32_t width, int32_t height) {
     uint32_t len = turtle.penPos -> length;
-    unitype *ren = turtle.penPos -> data;
-    int8_t *renType = turtle.penPos -> type;
-    uint64_t oldHash = turtle.penHash;
-    turtle.penHash = 0; // I don't use this but it's an idea: https://stackoverflow.com/questions/57455444/very-low-collision-non-cryptographic-hashing-function
+    turtle_command_t *ren = turtle.penPos -> data;
+    double xfact = (turtle.bounds[2] - turtle.bounds[0]) / 2;
+    double yfact = (turtle.bounds[3] - turtle.bounds[1]) / 2;
+    xfact = 1 / xfact;
+    yfact = 1 / yfact;
+    /* circles and strokes are tessellated for their size on screen (level of detail) */
+    double pixelScale = 0;
+    if (width > 0 && height > 0) {
+        pixelScale = fmin((double) width / (turtle.bounds[2] - turtle.bounds[0]), (double) height / (turtle.bounds[3] - turtle.bounds[1]));
+    }
+    int8_t previousConnected = 0; // whether the last pen position was joined to this one by a quad
+    /* segment normals for the whole frame are found in one batch, the records are copied out into arrays of x and y first so that the batch is vectorised */
+    if (len * 4 > turtle.normalCapacity) {
+        turtle.normalCapacity = len * 4;
+        turtle.normals = realloc(turtle.normals, sizeof(float) * turtle.normalCapacity);
+    }
+    float *pointX = turtle.normals;
+    float *pointY = pointX + len;
+    float *normalX = pointY + len;
+    float *normalY = normalX + len;
     for (uint32_t i = 0; i < len; i++) {
-        turtle.penHash += (uint64_t) turtle.penPos -> data[i].p; // simple addition hash. I know not technically safe since i cast all sizes to 8 byte, but it should still work
+        pointX[i] = ren[i].x;
+        pointY[i] = ren[i].y;
     }
-    if (len != turtle.lastLength || oldHash != turtle.penHash) {
-        changed = 1;
-        turtle.lastLength = len;
+    if (len > 0) {
+        turtleStrokeNormals(len - 1, pointX, pointY, normalX, normalY);
     }
-    if (changed) {
-        double xfact = (turtle.bounds[2] - turtle.bounds[0]) / 2;
-        double yfact = (turtle.bounds[3] - turtle.bounds[1]) / 2;
-        xfact = 1 / xfact;
-        yfact = 1 / yfact;
-        double lastSize = -1;
-        double lastPrez = -1;
-        double precomputedLog = 5;
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        for (int32_t i = 0; i < (int32_t) len; i += 9) {
-            if (renType[i] == 'd') {
-                switch (ren[i + 7].h) {
-                case 0:
-                    if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d)) {
-                        precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                    }
-                    lastSize = ren[i + 2].d;
-                    lastPrez = ren[i + 8].d;
-                    turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                break;
-                case 1:
-                    turtleSquareRender(ren[i].d - ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d + ren[i + 2].d, ren[i + 1].d + ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                break;
-                case 2:
-                    turtleTriangleRender(ren[i].d - ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d + ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d, ren[i + 1].d + ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                break;
-                case 5:
-                    if (i - 9 < 0 || renType[i - 9] == 'c') {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d)) {
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        }
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
-                break;
-                default:
-                break;
-                }
-                if (i + 18 < (int32_t) len && renType[i + 9] == 'd' && ren[i + 7].h < 64 && (ren[i + 7].h == 4 || ren[i + 7].h == 5 || (fabs(ren[i].d - ren[i + 9].d) > ren[i + 2].d / 2 || fabs(ren[i + 1].d - ren[i + 10].d) > ren[i + 2].d / 2))) { // tests for next point continuity and also ensures that the next point is at sufficiently different coordinates
-                    double dir = atan((ren[i + 9].d - ren[i].d) / (ren[i + 1].d - ren[i + 10].d));
-                    double sinn = sin(dir + M_PI / 2);
-                    double coss = cos(dir + M_PI / 2);
-                    turtleQuadRender(ren[i].d + ren[i + 2].d * sinn, ren[i + 1].d - ren[i + 2].d * coss, ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i].d - ren[i + 2].d * sinn, ren[i + 1].d + ren[i + 2].d * coss, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                    if ((ren[i + 7].h == 4 || ren[i + 7].h == 5) && i + 18 < (int32_t) len && renType[i + 18] == 'd') {
-                        double dir2 = atan((ren[i + 18].d - ren[i + 9].d) / (ren[i + 10].d - ren[i + 19].d));
-                        double sinn2 = sin(dir2 + M_PI / 2);
-                        double coss2 = cos(dir2 + M_PI / 2);
-                        turtleTriangleRender(ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i + 9].d + ren[i + 11].d * sinn2, ren[i + 10].d - ren[i + 11].d * coss2, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact); // in a perfect world the program would know which one of these triangles to render (to blend the segments)
-                        turtleTriangleRender(ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i + 9].d - ren[i + 11].d * sinn2, ren[i + 10].d + ren[i + 11].d * coss2, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact); // however we live in a world where i am bad at math, so it just renders both no matter what (one has no effect)
-                    }
-                } else {
-                    if (ren[i + 7].h == 4 && i > 8 && renType[i - 8] == 'c') {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d)) {
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        }
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
-                    if (ren[i + 7].h == 5 && i > 8) {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d)) {
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        }
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
-                }
-                if (ren[i + 7].h == 64) { // blit circle
-                    if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d)) {
-                        precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                    }
-                    lastSize = ren[i + 2].d;
-                    lastPrez = ren[i + 8].d;
-                    turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                }
-                if (ren[i + 7].h == 66) { // blit triangle
-                    turtleTriangleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 8].d, ren[i + 9].d, ren[i + 10].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                    i += 9;
-                }
-                if (ren[i + 7].h == 67) { // blit quad
-                    turtleQuadRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 8].d, ren[i + 9].d, ren[i + 10].d, ren[i + 11].d, ren[i + 17].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                    i += 9;
+    turtle.vertexCount = 0;
+    turtle.indexCount = 0;
+    for (int32_t i = 0; i < (int32_t) len; i++) {
+        turtle_command_t *command = &ren[i];
+        uint8_t shape = command -> shape;
+        if (shape == TURTLE_BUFFER_BREAK) {
+            previousConnected = 0;
+            continue;
+        }
+        double r = command -> color[0] / 255.0;
+        double g = command -> color[1] / 255.0;
+        double b = command -> color[2] / 255.0;
+        double a = command -> color[3] / 255.0;
+        double size = command -> size;
+        /* blit shapes */
+        if (shape >= 64) {
+            switch (shape) {
+            case TURTLE_BUFFER_CIRCLE:
+                turtleCircleRender(command -> x, command -> y, size, r, g, b, a, xfact, yfact, turtleCircleSides(command -> prez, size, pixelScale));
+            break;
+            case TURTLE_BUFFER_TRIANGLE:
+                turtleTriangleRender(ren[i].x, ren[i].y, ren[i + 1].x, ren[i + 1].y, ren[i + 2].x, ren[i + 2].y, r, g, b, a, xfact, yfact);
+                i += 2;
+            break;
+            case TURTLE_BUFFER_QUAD:
+                turtleQuadRender(ren[i].x, ren[i].y, ren[i + 1].x, ren[i + 1].y, ren[i + 2].x, ren[i + 2].y, ren[i + 3].x, ren[i + 3].y, r, g, b, a, xfact, yfact);
+                i += 3;
+            break;
+            case TURTLE_BUFFER_TRIANGLE_3D: {
+                double projected[6] = {ren[i].x, ren[i].y, ren[i + 1].x, ren[i + 1].y, ren[i + 2].x, ren[i + 2].y};
+                for (int32_t k = 0; k < 3; k++) {
+                    turtlePerspective(ren[i + k].x, ren[i + k].y, ren[i + k].size, &projected[k * 2], &projected[k * 2 + 1]);
                 }
-                if (ren[i + 7].h == 128) { // blit 3D sphere
-
+                turtleTriangleRender(projected[0], projected[1], projected[2], projected[3], projected[4], projected[5], r, g, b, a, xfact, yfact);
+                i += 2;
+            break;
+            }
+            case TURTLE_BUFFER_INSTANCE: {
+                /* everything before the instances is drawn first so that they overlap it */
+                uint32_t end = i;
+                while (end < len && ren[end].shape == TURTLE_BUFFER_INSTANCE) {
+                    end += 1 + ren[end].reserved;
                 }
-                if (ren[i + 7].h == 129) { // blit 3D circle
-
+                if (end > len) {
+                    end = len;
                 }
-                if (ren[i + 7].h == 130) { // blit 3D triangle
-                    turtlePerspective(ren[i].d, ren[i + 1].d, ren[i + 2].d, &ren[i].d, &ren[i + 1].d);
-                    turtlePerspective(ren[i + 8].d, ren[i + 9].d, ren[i + 10].d, &ren[i + 8].d, &ren[i + 9].d);
-                    turtlePerspective(ren[i + 11].d, ren[i + 12].d, ren[i + 13].d, &ren[i + 11].d, &ren[i + 12].d);
-                    turtleTriangleRender(ren[i].d, ren[i + 1].d, ren[i + 8].d, ren[i + 9].d, ren[i + 11].d, ren[i + 12].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                    i += 9;
-                }
-                if (ren[i + 7].h == 131) { // blit 3D quad
-
+                if (turtle.instanceRenderer != NULL && turtle.vertexSink == NULL) {
+                    turtleVertexFlush();
+                    turtle.instanceRenderer(turtle.instanceData, &ren[i], end - i, xfact, yfact, pixelScale);
                 }
+                i = end - 1;
+            break;
+            }
+            default:
+            break;
+            }
+            previousConnected = 0;
+            continue;
+        }
+        /* pen positions */
+        int32_t sides = turtleCircleSides(command -> prez, size, pixelScale);
+        int8_t tiny = size * pixelScale < TURTLE_LOD_STROKE; // strokes thinner than this are drawn as bare quads (no round caps or joins)
+        turtle_command_t *next = &ren[i + 1];
+        int8_t connected = i + 2 < (int32_t) len && next -> shape < 64 && (shape == 4 || shape == 5 || (fabs(command -> x - next -> x) > size / 2 || fabs(command -> y - next -> y) > size / 2)); // tests for next point continuity and also ensures that the next point is at sufficiently different coordinates
+        switch (shape) {
+        case 0:
+            if (!tiny || (!connected && !previousConnected)) {
+                turtleCircleRender(command -> x, command -> y, size, r, g, b, a, xfact, yfact, sides);
+            }
+        break;
+        case 1:
+            turtleSquareRender(command -> x - size, command -> y - size, command -> x + size, command -> y + size, r, g, b, a, xfact, yfact);
+        break;
+        case 2:
+            turtleTriangleRender(command -> x - size, command -> y - size, command -> x + size, command -> y - size, command -> x, command -> y + size, r, g, b, a, xfact, yfact);
+        break;
+        case 5:
+            if ((i == 0 || ren[i - 1].shape == TURTLE_BUFFER_BREAK) && (!tiny || !connected)) {
+                turtleCircleRender(command -> x, command -> y, size, r, g, b, a, xfact, yfact, sides);
+            }
+        break;
+        default:
+        break;
+        }
+        if (connected) {
+            double offsetX = size * normalX[i];
+            double offsetY = size * normalY[i];
+            turtleQuadRender(command -> x + offsetX, command -> y + offsetY, next -> x + offsetX, next -> y + offsetY, next -> x - offsetX, next -> y - offsetY, command -> x - offsetX, command -> y - offsetY, r, g, b, a, xfact, yfact);
+            if ((shape == 4 || shape == 5) && ren[i + 2].shape < 64 && !tiny) {
+                /* the gap between this segment and the next is on the outside of the turn, which is the side that the next segment turns away from */
+                turtle_command_t *after = &ren[i + 2];
+                double side = normalX[i] * (after -> x - next -> x) + normalY[i] * (after -> y - next -> y) > 0 ? -next -> size : next -> size;
+                turtleTriangleRender(next -> x + offsetX, next -> y + offsetY, next -> x - offsetX, next -> y - offsetY, next -> x + side * normalX[i + 1], next -> y + side * normalY[i + 1], r, g, b, a, xfact, yfact);
+            }
+        } else {
+            if (shape == 4 && i > 0 && ren[i - 1].shape == TURTLE_BUFFER_BREAK) {
+                turtleCircleRender(command -> x, command -> y, size, r, g, b, a, xfact, yfact, sides);
+            }
+            if (shape == 5 && i > 0 && (!tiny || !previousConnected)) {
+                turtleCircleRender(command -> x, command -> y, size, r, g, b, a, xfact, yfact, sides);
             }
         }
+        previousConnected = connected;
+    }
+    turtleVertexFlush();
+}
+
+/* draws the turtle's path on the screen */
+void turtleUpdate() {
+    /* the penPos buffer hashes its records as they are added, so an unchanged frame is found without reading them and is neither drawn nor swapped */
+    int8_t changed = 0;
+    if (turtle.penPos -> length != turtle.lastLength || turtle.penPos -> hash != turtle.penHash || turtle.redraw) {
+        changed = 1;
+        turtle.lastLength = turtle.penPos -> length;
+        turtle.penHash = turtle.penPos -> hash;
+        turtle.redraw = 0;
+    }
+    if (changed) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        turtleTessellate(turtle.screenbounds[0], turtle.screenbounds[1]);
         glfwSwapBuffers(turtle.window);
     }
     glfwPollEvents();
@@ -828,6 +941,18 @@ void turtleUpdate() {
     
 }
 
+/* waits until an input event arrives or timeout seconds pass without drawing anything, use in place of turtleUpdate when nothing on screen could have changed */
+void turtleWaitEvents(double timeout) {
+    glfwWaitEventsTimeout(timeout);
+    if (glfwWindowShouldClose(turtle.window)) {
+        turtle.close = 1;
+        turtle.events++;
+        if (turtle.shouldClose) {
+            glfwTerminate();
+        }
+    }
+}
+
 /* keeps the window open while doing nothing else (from python turtleMainLoop()) */
 void turtleMainLoop() {
     while (turtle.close == 0) {
@@ -838,6 +963,15 @@ void turtleMainLoop() {
 /* free turtle memory */
 void turtleFree() {
     list_free(turtle.keyPressed);
-    list_free(turtle.penPos);
+    turtleBufferFree(turtle.penPos);
+    free(turtle.vertices);
+    free(turtle.indices);
+    free(turtle.normals);
+    if (turtle.vertexProgram != 0) {
+        glDeleteProgram(turtle.vertexProgram);
+        glDeleteBuffers(1, &turtle.vertexBuffer);
+        glDeleteBuffers(1, &turtle.indexBuffer);
+    }
+    turtleCircleFree();
 }
 #endif
\ No newline at end of file
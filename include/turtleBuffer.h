@@ -0,0 +1,139 @@
+#ifndef TURTLEBUFFERSET
+#define TURTLEBUFFERSET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+19.10.26:
+turtleBuffer - packed command buffer for the turtle renderer
+
+Every pen position and blit shape is one fixed size record (20 bytes) in a flat array instead of 9 unitypes in a list
+Records must be fully written (including reserved) so that equal records are equal bytes
+A record's shape is a pen shape (0 - 5), TURTLE_BUFFER_BREAK where the pen was lifted, or a blit signifier
+Blit shapes take one record per vertex (the first record says which shape it is and every record holds the colour), size holds the radius of a blit circle and z of a 3D triangle
+An instance record (TURTLE_BUFFER_INSTANCE) is drawn by a renderer that the user gives turtle.h, its reserved field holds the number of payload records after it that carry its values (3 floats each in x, y and size). Payload records are not positions, so they are not moved
+The buffer keeps a hash of its records that is updated as they are added, so comparing two frames never walks the records. Records must not be changed after they are added
+
+example usage:
+turtle_buffer_t *buffer = turtleBufferInit();
+turtle_command_t command = {10, 20, 1, {0, 0, 0, 0}, 0, 9, 0};
+turtleBufferAdd(buffer, &command);
+turtleBufferBreak(buffer); // lift the pen
+printf("%llu\n", (unsigned long long) buffer -> hash);
+turtleBufferFree(buffer);
+*/
+
+#define TURTLE_BUFFER_BREAK 255 // shape of the record that ends a stroke
+#define TURTLE_BUFFER_CIRCLE 64 // blit circle, 1 record
+#define TURTLE_BUFFER_TRIANGLE 66 // blit triangle, 3 records
+#define TURTLE_BUFFER_QUAD 67 // blit quad, 4 records
+#define TURTLE_BUFFER_INSTANCE 68 // instance drawn by turtle.instanceRenderer, 1 record followed by its payload
+#define TURTLE_BUFFER_PAYLOAD 69 // values of the instance before it
+#define TURTLE_BUFFER_TRIANGLE_3D 130 // blit 3D triangle, 3 records
+#define TURTLE_BUFFER_SEED 0x243F6A8885A308D3ULL // hash of an empty buffer
+
+typedef struct {
+    float x;
+    float y;
+    float size; // pen size (radius)
+    uint8_t color[4]; // red, green, blue, alpha (0 - 255)
+    uint8_t shape;
+    uint8_t prez; // circle precision (turtle.circleprez)
+    uint16_t reserved; // number of payload records of an instance, otherwise always 0 (so that a record has no padding and can be hashed as words)
+} turtle_command_t;
+
+typedef struct {
+    uint32_t length;
+    uint32_t capacity;
+    turtle_command_t *data;
+    uint64_t hash; // hash of the records in order
+} turtle_buffer_t;
+
+turtle_buffer_t *turtleBufferInit() {
+    turtle_buffer_t *buffer = malloc(sizeof(turtle_buffer_t));
+    buffer -> length = 0;
+    buffer -> capacity = 16;
+    buffer -> data = malloc(sizeof(turtle_command_t) * buffer -> capacity);
+    buffer -> hash = TURTLE_BUFFER_SEED;
+    return buffer;
+}
+
+/* remove every record */
+void turtleBufferClear(turtle_buffer_t *buffer) {
+    buffer -> length = 0;
+    buffer -> hash = TURTLE_BUFFER_SEED;
+}
+
+/* add a record to a running hash, every bit of every field moves the whole hash and the order of records matters */
+uint64_t turtleBufferHash(uint64_t hash, const turtle_command_t *command) {
+    uint64_t words[3] = {0, 0, 0};
+    memcpy(words, command, sizeof(turtle_command_t));
+    for (int32_t i = 0; i < 3; i++) {
+        hash ^= words[i] * 0x9E3779B97F4A7C15ULL;
+        hash = (hash << 31 | hash >> 33) * 0xBF58476D1CE4E5B9ULL;
+    }
+    return hash ^ (hash >> 29);
+}
+
+/* make room for length records */
+void turtleBufferReserve(turtle_buffer_t *buffer, uint32_t length) {
+    if (length > buffer -> capacity) {
+        while (buffer -> capacity < length) {
+            buffer -> capacity *= 2;
+        }
+        buffer -> data = realloc(buffer -> data, sizeof(turtle_command_t) * buffer -> capacity);
+    }
+}
+
+/* add a copy of a record to the end of the buffer */
+void turtleBufferAdd(turtle_buffer_t *buffer, const turtle_command_t *command) {
+    turtleBufferReserve(buffer, buffer -> length + 1);
+    buffer -> data[buffer -> length++] = *command;
+    buffer -> hash = turtleBufferHash(buffer -> hash, command);
+}
+
+/* end the current stroke, does nothing if the buffer is empty or already ends in a break */
+void turtleBufferBreak(turtle_buffer_t *buffer) {
+    if (buffer -> length > 0 && buffer -> data[buffer -> length - 1].shape != TURTLE_BUFFER_BREAK) {
+        turtle_command_t command;
+        memset(&command, 0, sizeof(turtle_command_t));
+        command.shape = TURTLE_BUFFER_BREAK;
+        turtleBufferAdd(buffer, &command);
+    }
+}
+
+/* convert a colour channel from 0 - 1 to 0 - 255 */
+uint8_t turtleBufferChannel(double value) {
+    if (value <= 0) {
+        return 0;
+    }
+    if (value >= 1) {
+        return 255;
+    }
+    return (uint8_t) (value * 255 + 0.5);
+}
+
+/* append records (from another buffer) moved by (x, y) */
+void turtleBufferAppend(turtle_buffer_t *buffer, turtle_buffer_t *records, double x, double y) {
+    uint32_t start = buffer -> length;
+    turtleBufferReserve(buffer, start + records -> length);
+    memcpy(buffer -> data + start, records -> data, sizeof(turtle_command_t) * records -> length);
+    buffer -> length += records -> length;
+    for (uint32_t i = start; i < buffer -> length; i++) {
+        if (buffer -> data[i].shape != TURTLE_BUFFER_PAYLOAD) {
+            buffer -> data[i].x += x;
+            buffer -> data[i].y += y;
+        }
+        buffer -> hash = turtleBufferHash(buffer -> hash, &buffer -> data[i]);
+    }
+}
+
+void turtleBufferFree(turtle_buffer_t *buffer) {
+    free(buffer -> data);
+    free(buffer);
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef TURTLECIRCLESET
+#define TURTLECIRCLESET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+/*
+19.10.26:
+turtleCircle - unit circle tables for the turtle renderers (shared by turtle.h and turtleTextures.h)
+
+A circle with n sides is drawn from a table of n unit vectors, so drawing one is a multiply and add per vertex with no sin or cos
+Tables are built the first time a number of sides is asked for and kept for the rest of the program
+The number of sides of a circle (prez * log(2.71 + radius)) is looked up in a small cache keyed by prez and radius, since a frame only uses a few pen sizes
+Given the size of a coordinate in pixels, circles get no more sides than they need to look round on screen (the polygon strays at most TURTLE_CIRCLE_TOLERANCE pixels from the circle), so small circles are cheap
+
+example usage:
+int32_t sides = turtleCircleSides(9, 5, 0); // 9 * log(7.71) rounded up = 19 (a pixel scale of 0 turns off level of detail)
+const float *unit = turtleCircleUnit(sides); // x (sin) and y (cos) of each vertex, starting at the top and going clockwise
+for (int32_t i = 0; i < sides; i++) {
+    printf("%f %f\n", 10 + 5 * unit[i * 2], 20 + 5 * unit[i * 2 + 1]); // vertex of a circle at (10, 20) with radius 5
+}
+*/
+
+#define TURTLE_CIRCLE_MAX_SIDES 512 // circles never have more sides than this
+#define TURTLE_CIRCLE_MIN_SIDES 4 // circles smaller than a few pixels are drawn as squares
+#define TURTLE_CIRCLE_TOLERANCE 0.25 // pixels that the edge of a circle may be off by
+#define TURTLE_CIRCLE_SIDES_CACHE 64 // entries in the sides cache (power of two)
+
+typedef struct {
+    float *tables[TURTLE_CIRCLE_MAX_SIDES + 1]; // unit vectors of a circle with each number of sides, NULL until used
+    double cachePrez[TURTLE_CIRCLE_SIDES_CACHE];
+    double cacheRadius[TURTLE_CIRCLE_SIDES_CACHE];
+    double cacheScale[TURTLE_CIRCLE_SIDES_CACHE];
+    int32_t cacheSides[TURTLE_CIRCLE_SIDES_CACHE]; // 0 if the entry is empty
+} turtle_circle_t;
+
+turtle_circle_t turtleCircleCache;
+
+/* unit vectors (sin, cos pairs) of a circle with sides sides (3 to TURTLE_CIRCLE_MAX_SIDES) */
+const float *turtleCircleUnit(int32_t sides) {
+    if (sides < 3) {
+        sides = 3;
+    }
+    if (sides > TURTLE_CIRCLE_MAX_SIDES) {
+        sides = TURTLE_CIRCLE_MAX_SIDES;
+    }
+    if (turtleCircleCache.tables[sides] == NULL) {
+        float *table = malloc(sizeof(float) * sides * 2);
+        for (int32_t i = 0; i < sides; i++) {
+            table[i * 2] = sin(2 * i * M_PI / sides);
+            table[i * 2 + 1] = cos(2 * i * M_PI / sides);
+        }
+        turtleCircleCache.tables[sides] = table;
+    }
+    return turtleCircleCache.tables[sides];
+}
+
+/* number of sides of a circle with precision prez (turtle.circleprez) and radius radius, pixelScale is the size of one coordinate in pixels (0 to ignore it) */
+int32_t turtleCircleSides(double prez, double radius, double pixelScale) {
+    uint64_t bits;
+    memcpy(&bits, &radius, sizeof(double));
+    uint32_t slot = (uint32_t) ((bits ^ (bits >> 29) ^ (uint64_t) (prez * 131) ^ (uint64_t) (pixelScale * 8191)) * 0x9E3779B97F4A7C15ULL >> 58) & (TURTLE_CIRCLE_SIDES_CACHE - 1);
+    if (turtleCircleCache.cacheSides[slot] != 0 && turtleCircleCache.cacheRadius[slot] == radius && turtleCircleCache.cachePrez[slot] == prez && turtleCircleCache.cacheScale[slot] == pixelScale) {
+        return turtleCircleCache.cacheSides[slot];
+    }
+    double sides = ceil(prez * log(2.71 + radius));
+    if (pixelScale > 0) {
+        /* a polygon with n sides strays pixels * (1 - cos(pi / n)) from a circle of pixels radius */
+        double pixels = radius * pixelScale;
+        double needed = TURTLE_CIRCLE_MIN_SIDES;
+        if (pixels > TURTLE_CIRCLE_TOLERANCE) {
+            needed = ceil(M_PI / acos(1 - TURTLE_CIRCLE_TOLERANCE / pixels));
+        }
+        if (needed < TURTLE_CIRCLE_MIN_SIDES) {
+            needed = TURTLE_CIRCLE_MIN_SIDES;
+        }
+        if (needed < sides) {
+            sides = needed;
+        }
+    }
+    if (!(sides >= 3)) { // also catches nan
+        sides = 3;
+    }
+    if (sides > TURTLE_CIRCLE_MAX_SIDES) {
+        sides = TURTLE_CIRCLE_MAX_SIDES;
+    }
+    turtleCircleCache.cachePrez[slot] = prez;
+    turtleCircleCache.cacheRadius[slot] = radius;
+    turtleCircleCache.cacheScale[slot] = pixelScale;
+    turtleCircleCache.cacheSides[slot] = (int32_t) sides;
+    return (int32_t) sides;
+}
+
+/* free every table */
+void turtleCircleFree() {
+    for (int32_t i = 0; i <= TURTLE_CIRCLE_MAX_SIDES; i++) {
+        free(turtleCircleCache.tables[i]);
+        turtleCircleCache.tables[i] = NULL;
+    }
+    memset(turtleCircleCache.cacheSides, 0, sizeof(turtleCircleCache.cacheSides));
+}
+
+#endif
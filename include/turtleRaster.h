@@ -0,0 +1,460 @@
+#ifndef TURTLERASTERSET
+#define TURTLERASTERSET // include guard
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "turtle.h"
+#ifdef OS_WINDOWS
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*
+19.10.26:
+turtleRaster - draws the turtle's path on the CPU into an image in memory, so that frames can be rendered with no window, display or GPU
+
+The turtle's path is made into the same triangles that turtleUpdate gives OpenGL (turtleTessellate), and they are filled with the same blending (alpha 0 is opaque and 255 is invisible, like the rest of the turtle)
+The image is split into tiles of TURTLE_RASTER_TILE pixels, each triangle is put in the list of every tile it touches and then threads fill whole tiles at once, so no two threads ever write the same pixel and every pixel gets its triangles in order
+Pixels are filled if their centre is in a triangle, a pixel on an edge shared by two triangles goes to exactly one of them (so a translucent shape made of many triangles is never blended twice)
+Coverage and blending follow what OpenGL implementations do (8 bits of subpixel precision, y up, products of 8 bit colours rounded separately), so an image matches the window pixel for pixel without multisampling
+Instances (turtleInstance) are not drawn, they need OpenGL
+turtleRasterParallel spreads any numbered work over threads the same way (threads are started once and kept waiting for more work), so frames of an animation can be drawn on different threads with a raster (threads = 1) each
+
+The turtle can be set up without a window with turtleInitHeadless
+
+example usage:
+turtleInitHeadless(1280, 720, -320, -180, 320, 180);
+turtle_raster_t *raster = turtleRasterInit(1280, 720, 0); // 0 uses a thread for each core
+turtleGoto(0, 0);
+turtlePenDown();
+turtleGoto(100, 50);
+turtlePenUp();
+turtleRasterRender(raster);
+fwrite(raster -> pixels, 4, 1280 * 720, file); // RGBA, top row first
+turtleRasterFree(raster);
+*/
+
+#define TURTLE_RASTER_TILE 64 // width and height of a tile (pixels)
+#define TURTLE_RASTER_SUBPIXEL 256 // vertices are snapped to this fraction of a pixel
+#define TURTLE_RASTER_LIMIT 536870912 // vertices further than this (in subpixels) from the image are clamped, so that edge functions fit in 64 bits
+#define TURTLE_RASTER_MAX_THREADS 64
+
+/* a triangle ready to be filled, vertices are in subpixels (y up from the bottom row, like OpenGL's window coordinates) and wind so that the edge functions are positive inside */
+typedef struct {
+    int64_t x[3];
+    int64_t y[3];
+    int32_t bounds[4]; // pixels that the triangle can cover (minX, minY, maxX, maxY inclusive, y up), inside the image
+    uint8_t color[4];
+} turtle_raster_triangle_t;
+
+typedef struct {
+    int32_t width;
+    int32_t height;
+    uint8_t *pixels; // width * height RGBA pixels, top row first (alpha is always 255)
+    int32_t threads; // threads that fill tiles
+    int32_t tilesX;
+    int32_t tilesY;
+    turtle_raster_triangle_t *triangles; // triangles of the current flush
+    uint32_t triangleCount;
+    uint32_t triangleCapacity;
+    uint32_t **tileLists; // index of every triangle that touches each tile, in order
+    uint32_t *tileCounts;
+    uint32_t *tileCapacities;
+} turtle_raster_t;
+
+/* work shared by the threads of turtleRasterParallel */
+typedef struct {
+    void (*function)(void *data, int32_t index, int32_t thread);
+    void *data;
+    int32_t count;
+    int32_t next; // next index for a thread to take
+} turtle_raster_work_t;
+
+/* threads that wait for turtleRasterParallel's work, they are started the first time they are needed and then kept */
+typedef struct {
+#ifdef OS_WINDOWS
+    SRWLOCK lock;
+    CONDITION_VARIABLE wake; // there is new work
+    CONDITION_VARIABLE done; // a thread finished its work
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+#endif
+    int32_t started; // threads in the pool (not counting the caller)
+    int32_t spawnFailed; // a thread could not be started, so don't try again
+    int32_t inUse; // a turtleRasterParallel call has the pool (another one at the same time works alone)
+    turtle_raster_work_t *work;
+    uint32_t generation; // goes up for each piece of work
+    uint32_t seen[TURTLE_RASTER_MAX_THREADS]; // last generation each thread looked at
+    int32_t wanted; // threads 1 to wanted - 1 take part in the current work
+    int32_t busy; // threads still working on it
+} turtle_raster_pool_t;
+
+#ifdef OS_WINDOWS
+turtle_raster_pool_t turtleRasterPool = {SRWLOCK_INIT, CONDITION_VARIABLE_INIT, CONDITION_VARIABLE_INIT};
+#else
+turtle_raster_pool_t turtleRasterPool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER};
+#endif
+
+/* number of cores */
+int32_t turtleRasterCores() {
+#ifdef OS_WINDOWS
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int32_t cores = info.dwNumberOfProcessors;
+#else
+    int32_t cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return cores < 1 ? 1 : cores;
+}
+
+/* makes an image of width by height pixels that is filled by threads threads (0 for one for each core) */
+turtle_raster_t *turtleRasterInit(int32_t width, int32_t height, int32_t threads) {
+    turtle_raster_t *raster = malloc(sizeof(turtle_raster_t));
+    raster -> width = width;
+    raster -> height = height;
+    raster -> pixels = malloc((size_t) width * height * 4);
+    if (threads <= 0) {
+        threads = turtleRasterCores();
+    }
+    if (threads > TURTLE_RASTER_MAX_THREADS) {
+        threads = TURTLE_RASTER_MAX_THREADS;
+    }
+    raster -> threads = threads;
+    raster -> tilesX = (width + TURTLE_RASTER_TILE - 1) / TURTLE_RASTER_TILE;
+    raster -> tilesY = (height + TURTLE_RASTER_TILE - 1) / TURTLE_RASTER_TILE;
+    raster -> triangles = NULL;
+    raster -> triangleCount = 0;
+    raster -> triangleCapacity = 0;
+    int32_t tiles = raster -> tilesX * raster -> tilesY;
+    raster -> tileLists = calloc(tiles, sizeof(uint32_t *));
+    raster -> tileCounts = calloc(tiles, sizeof(uint32_t));
+    raster -> tileCapacities = calloc(tiles, sizeof(uint32_t));
+    return raster;
+}
+
+/* fills the image with a colour (0 - 255) */
+void turtleRasterClear(turtle_raster_t *raster, double r, double g, double b) {
+    uint8_t color[4] = {turtleBufferChannel(r / 255), turtleBufferChannel(g / 255), turtleBufferChannel(b / 255), 255};
+    uint32_t pixel;
+    memcpy(&pixel, color, 4);
+    uint32_t *pixels = (uint32_t *) raster -> pixels;
+    for (int32_t i = 0; i < raster -> width * raster -> height; i++) {
+        pixels[i] = pixel;
+    }
+}
+
+/* a * b / 255 rounded, the way GPUs blend 8 bit colours */
+uint32_t turtleRasterMultiply(uint32_t a, uint32_t b) {
+    uint32_t product = a * b + 128;
+    return (product + (product >> 8)) >> 8;
+}
+
+/* fills the triangles that touch one tile */
+void turtleRasterTile(turtle_raster_t *raster, int32_t tile) {
+    int32_t tileX = tile % raster -> tilesX * TURTLE_RASTER_TILE;
+    int32_t tileY = tile / raster -> tilesX * TURTLE_RASTER_TILE;
+    uint32_t *list = raster -> tileLists[tile];
+    for (uint32_t k = 0; k < raster -> tileCounts[tile]; k++) {
+        turtle_raster_triangle_t *triangle = &raster -> triangles[list[k]];
+        int32_t minX = triangle -> bounds[0] > tileX ? triangle -> bounds[0] : tileX;
+        int32_t minY = triangle -> bounds[1] > tileY ? triangle -> bounds[1] : tileY;
+        int32_t maxX = triangle -> bounds[2] < tileX + TURTLE_RASTER_TILE - 1 ? triangle -> bounds[2] : tileX + TURTLE_RASTER_TILE - 1;
+        int32_t maxY = triangle -> bounds[3] < tileY + TURTLE_RASTER_TILE - 1 ? triangle -> bounds[3] : tileY + TURTLE_RASTER_TILE - 1;
+        /* edge functions at the centre of the first pixel and how they change from pixel to pixel */
+        int64_t row[3];
+        int64_t stepX[3];
+        int64_t stepY[3];
+        int64_t centerX = (int64_t) minX * TURTLE_RASTER_SUBPIXEL + TURTLE_RASTER_SUBPIXEL / 2;
+        int64_t centerY = (int64_t) minY * TURTLE_RASTER_SUBPIXEL + TURTLE_RASTER_SUBPIXEL / 2;
+        for (int32_t e = 0; e < 3; e++) {
+            int64_t ax = triangle -> x[e];
+            int64_t ay = triangle -> y[e];
+            int64_t dx = triangle -> x[(e + 1) % 3] - ax;
+            int64_t dy = triangle -> y[(e + 1) % 3] - ay;
+            row[e] = dx * (centerY - ay) - dy * (centerX - ax);
+            if (!(dy < 0 || (dy == 0 && dx > 0))) {
+                row[e] -= 1; // a pixel exactly on the edge belongs to the triangle on the other side
+            }
+            stepX[e] = -dy * TURTLE_RASTER_SUBPIXEL;
+            stepY[e] = dx * TURTLE_RASTER_SUBPIXEL;
+        }
+        uint8_t *color = triangle -> color;
+        uint32_t alpha = color[3];
+        uint32_t opaque;
+        memcpy(&opaque, color, 4);
+        ((uint8_t *) &opaque)[3] = 255;
+        for (int32_t y = minY; y <= maxY; y++) {
+            int64_t edge0 = row[0];
+            int64_t edge1 = row[1];
+            int64_t edge2 = row[2];
+            uint8_t *pixel = raster -> pixels + ((size_t) (raster -> height - 1 - y) * raster -> width + minX) * 4;
+            for (int32_t x = minX; x <= maxX; x++) {
+                if ((edge0 | edge1 | edge2) >= 0) {
+                    if (alpha == 0) {
+                        memcpy(pixel, &opaque, 4);
+                    } else {
+                        /* source * (1 - alpha) + destination * alpha */
+                        for (int32_t c = 0; c < 3; c++) {
+                            pixel[c] = turtleRasterMultiply(color[c], 255 - alpha) + turtleRasterMultiply(pixel[c], alpha);
+                        }
+                    }
+                }
+                edge0 += stepX[0];
+                edge1 += stepX[1];
+                edge2 += stepX[2];
+                pixel += 4;
+            }
+            row[0] += stepY[0];
+            row[1] += stepY[1];
+            row[2] += stepY[2];
+        }
+    }
+}
+
+void turtleRasterPoolLock() {
+#ifdef OS_WINDOWS
+    AcquireSRWLockExclusive(&turtleRasterPool.lock);
+#else
+    pthread_mutex_lock(&turtleRasterPool.lock);
+#endif
+}
+
+void turtleRasterPoolUnlock() {
+#ifdef OS_WINDOWS
+    ReleaseSRWLockExclusive(&turtleRasterPool.lock);
+#else
+    pthread_mutex_unlock(&turtleRasterPool.lock);
+#endif
+}
+
+#ifdef OS_WINDOWS
+#define turtleRasterPoolWait(condition) SleepConditionVariableSRW(&turtleRasterPool.condition, &turtleRasterPool.lock, INFINITE, 0)
+#define turtleRasterPoolSignal(condition) WakeAllConditionVariable(&turtleRasterPool.condition)
+#else
+#define turtleRasterPoolWait(condition) pthread_cond_wait(&turtleRasterPool.condition, &turtleRasterPool.lock)
+#define turtleRasterPoolSignal(condition) pthread_cond_broadcast(&turtleRasterPool.condition)
+#endif
+
+/* takes indices until there are none left */
+void turtleRasterRun(turtle_raster_work_t *work, int32_t thread) {
+    for (int32_t index = __atomic_fetch_add(&work -> next, 1, __ATOMIC_RELAXED); index < work -> count; index = __atomic_fetch_add(&work -> next, 1, __ATOMIC_RELAXED)) {
+        work -> function(work -> data, index, thread);
+    }
+}
+
+/* a pool thread, data is its thread number (1 and up) */
+#ifdef OS_WINDOWS
+DWORD WINAPI turtleRasterWorker(LPVOID data) {
+#else
+void *turtleRasterWorker(void *data) {
+#endif
+    int32_t thread = (intptr_t) data;
+    turtleRasterPoolLock();
+    while (1) {
+        while (turtleRasterPool.seen[thread] == turtleRasterPool.generation) {
+            turtleRasterPoolWait(wake);
+        }
+        turtleRasterPool.seen[thread] = turtleRasterPool.generation;
+        if (thread >= turtleRasterPool.wanted) {
+            continue;
+        }
+        turtle_raster_work_t *work = turtleRasterPool.work;
+        turtleRasterPoolUnlock();
+        turtleRasterRun(work, thread);
+        turtleRasterPoolLock();
+        turtleRasterPool.busy--;
+        if (turtleRasterPool.busy == 0) {
+            turtleRasterPoolSignal(done);
+        }
+    }
+    return 0;
+}
+
+/* starts pool threads until there are helpers of them (or one can't be started). Call with the lock held */
+void turtleRasterPoolGrow(int32_t helpers) {
+    while (turtleRasterPool.started < helpers && !turtleRasterPool.spawnFailed) {
+        intptr_t thread = turtleRasterPool.started + 1;
+        turtleRasterPool.seen[thread] = turtleRasterPool.generation;
+#ifdef OS_WINDOWS
+        HANDLE handle = CreateThread(NULL, 0, turtleRasterWorker, (LPVOID) thread, 0, NULL);
+        if (handle == NULL) {
+            turtleRasterPool.spawnFailed = 1;
+            break;
+        }
+        CloseHandle(handle);
+#else
+        pthread_t handle;
+        if (pthread_create(&handle, NULL, turtleRasterWorker, (void *) thread) != 0) {
+            turtleRasterPool.spawnFailed = 1;
+            break;
+        }
+        pthread_detach(handle);
+#endif
+        turtleRasterPool.started++;
+    }
+}
+
+/* calls function(data, index, thread) for every index from 0 to count - 1 on up to threads threads (this one included), thread is which of them (0 to threads - 1) so that each can have its own scratch space. Returns when every call has
+The other threads come from a pool that is kept between calls, if fewer can be started (or another call has the pool) this thread does the rest of the work */
+void turtleRasterParallel(int32_t threads, int32_t count, void (*function)(void *data, int32_t index, int32_t thread), void *data) {
+    turtle_raster_work_t work = {function, data, count, 0};
+    if (threads > TURTLE_RASTER_MAX_THREADS) {
+        threads = TURTLE_RASTER_MAX_THREADS;
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    if (threads <= 1) {
+        turtleRasterRun(&work, 0);
+        return;
+    }
+    turtleRasterPoolLock();
+    if (turtleRasterPool.inUse) {
+        turtleRasterPoolUnlock();
+        turtleRasterRun(&work, 0);
+        return;
+    }
+    turtleRasterPoolGrow(threads - 1);
+    int32_t helpers = turtleRasterPool.started < threads - 1 ? turtleRasterPool.started : threads - 1;
+    turtleRasterPool.inUse = 1;
+    turtleRasterPool.work = &work;
+    turtleRasterPool.wanted = helpers + 1;
+    turtleRasterPool.busy = helpers;
+    turtleRasterPool.generation++;
+    turtleRasterPoolSignal(wake);
+    turtleRasterPoolUnlock();
+    turtleRasterRun(&work, 0);
+    turtleRasterPoolLock();
+    while (turtleRasterPool.busy > 0) {
+        turtleRasterPoolWait(done);
+    }
+    turtleRasterPool.inUse = 0;
+    turtleRasterPoolUnlock();
+}
+
+/* fills a tile if it has triangles (for turtleRasterParallel) */
+void turtleRasterTileWork(void *data, int32_t tile, int32_t thread) {
+    turtle_raster_t *raster = data;
+    if (raster -> tileCounts[tile] > 0) {
+        turtleRasterTile(raster, tile);
+    }
+}
+
+/* snaps a coordinate (-1 to 1) to subpixels across pixels pixels */
+int64_t turtleRasterSnap(double coordinate, int32_t pixels) {
+    double snapped = coordinate * 0.5 * pixels * TURTLE_RASTER_SUBPIXEL;
+    if (!(snapped > -TURTLE_RASTER_LIMIT)) { // also catches nan
+        snapped = -TURTLE_RASTER_LIMIT;
+    }
+    if (snapped > TURTLE_RASTER_LIMIT) {
+        snapped = TURTLE_RASTER_LIMIT;
+    }
+    return llround(snapped);
+}
+
+/* draws triangles (indexCount / 3 of them, coordinates -1 to 1 with y up like OpenGL) on the image in order, each in the colour of its first vertex */
+void turtleRasterTriangles(turtle_raster_t *raster, const turtle_vertex_t *vertices, const uint32_t *indices, uint32_t indexCount) {
+    uint32_t count = indexCount / 3;
+    if (count > raster -> triangleCapacity) {
+        raster -> triangleCapacity = count;
+        raster -> triangles = realloc(raster -> triangles, sizeof(turtle_raster_triangle_t) * count);
+    }
+    int32_t tiles = raster -> tilesX * raster -> tilesY;
+    memset(raster -> tileCounts, 0, sizeof(uint32_t) * tiles);
+    /* set up each triangle and put it in the lists of the tiles it touches */
+    raster -> triangleCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        turtle_raster_triangle_t *triangle = &raster -> triangles[raster -> triangleCount];
+        for (int32_t v = 0; v < 3; v++) {
+            const turtle_vertex_t *vertex = &vertices[indices[i * 3 + v]];
+            triangle -> x[v] = turtleRasterSnap(vertex -> x + 1, raster -> width);
+            triangle -> y[v] = turtleRasterSnap(vertex -> y + 1, raster -> height);
+        }
+        int64_t area = (triangle -> x[1] - triangle -> x[0]) * (triangle -> y[2] - triangle -> y[0]) - (triangle -> y[1] - triangle -> y[0]) * (triangle -> x[2] - triangle -> x[0]);
+        if (area == 0) {
+            continue;
+        }
+        if (area < 0) {
+            int64_t swap = triangle -> x[1];
+            triangle -> x[1] = triangle -> x[2];
+            triangle -> x[2] = swap;
+            swap = triangle -> y[1];
+            triangle -> y[1] = triangle -> y[2];
+            triangle -> y[2] = swap;
+        }
+        int64_t low[2] = {triangle -> x[0], triangle -> y[0]};
+        int64_t high[2] = {triangle -> x[0], triangle -> y[0]};
+        for (int32_t v = 1; v < 3; v++) {
+            low[0] = triangle -> x[v] < low[0] ? triangle -> x[v] : low[0];
+            low[1] = triangle -> y[v] < low[1] ? triangle -> y[v] : low[1];
+            high[0] = triangle -> x[v] > high[0] ? triangle -> x[v] : high[0];
+            high[1] = triangle -> y[v] > high[1] ? triangle -> y[v] : high[1];
+        }
+        /* pixels whose centres can be inside */
+        int32_t limit[2] = {raster -> width - 1, raster -> height - 1};
+        for (int32_t axis = 0; axis < 2; axis++) {
+            double first = ceil((double) low[axis] / TURTLE_RASTER_SUBPIXEL - 0.5);
+            double last = floor((double) high[axis] / TURTLE_RASTER_SUBPIXEL - 0.5);
+            triangle -> bounds[axis] = first < 0 ? 0 : (first > limit[axis] ? limit[axis] + 1 : first);
+            triangle -> bounds[axis + 2] = last > limit[axis] ? limit[axis] : (last < 0 ? -1 : last);
+        }
+        if (triangle -> bounds[0] > triangle -> bounds[2] || triangle -> bounds[1] > triangle -> bounds[3]) {
+            continue;
+        }
+        memcpy(triangle -> color, vertices[indices[i * 3]].color, 4);
+        for (int32_t tileY = triangle -> bounds[1] / TURTLE_RASTER_TILE; tileY <= triangle -> bounds[3] / TURTLE_RASTER_TILE; tileY++) {
+            for (int32_t tileX = triangle -> bounds[0] / TURTLE_RASTER_TILE; tileX <= triangle -> bounds[2] / TURTLE_RASTER_TILE; tileX++) {
+                int32_t tile = tileY * raster -> tilesX + tileX;
+                if (raster -> tileCounts[tile] >= raster -> tileCapacities[tile]) {
+                    raster -> tileCapacities[tile] = raster -> tileCapacities[tile] == 0 ? 64 : raster -> tileCapacities[tile] * 2;
+                    raster -> tileLists[tile] = realloc(raster -> tileLists[tile], sizeof(uint32_t) * raster -> tileCapacities[tile]);
+                }
+                raster -> tileLists[tile][raster -> tileCounts[tile]++] = raster -> triangleCount;
+            }
+        }
+        raster -> triangleCount++;
+    }
+    if (raster -> triangleCount == 0) {
+        return;
+    }
+    /* fill the tiles, this thread helps the others */
+    turtleRasterParallel(raster -> threads, tiles, turtleRasterTileWork, raster);
+}
+
+/* turtle.vertexSink that draws on a raster */
+void turtleRasterSink(void *data, turtle_vertex_t *vertices, uint32_t vertexCount, uint32_t *indices, uint32_t indexCount) {
+    turtleRasterTriangles(data, vertices, indices, indexCount);
+}
+
+/* draws the turtle's path on the image over the background colour */
+void turtleRasterRender(turtle_raster_t *raster) {
+    turtleRasterClear(raster, turtle.bgr, turtle.bgg, turtle.bgb);
+    void (*sink)(void *, turtle_vertex_t *, uint32_t, uint32_t *, uint32_t) = turtle.vertexSink;
+    void *sinkData = turtle.sinkData;
+    turtle.vertexSink = turtleRasterSink;
+    turtle.sinkData = raster;
+    turtleTessellate(raster -> width, raster -> height);
+    turtle.vertexSink = sink;
+    turtle.sinkData = sinkData;
+}
+
+void turtleRasterFree(turtle_raster_t *raster) {
+    for (int32_t i = 0; i < raster -> tilesX * raster -> tilesY; i++) {
+        free(raster -> tileLists[i]);
+    }
+    free(raster -> tileLists);
+    free(raster -> tileCounts);
+    free(raster -> tileCapacities);
+    free(raster -> triangles);
+    free(raster -> pixels);
+    free(raster);
+}
+
+#endif
@@ -17,8 +17,16 @@ texture support
 #include "glfw3.h"
 #include "list.h"
 #include "bufferList.h"
+#include "turtleCircle.h"
 
 #define BUFFER_OBJECT_SIZE 9
+#define TURTLE_CAPSULE_SIZE 9 // floats per capsule instance (x1, y1, x2, y2, radius, r, g, b, a)
+
+/* a run of triangles or capsules, the runs are drawn in order so that capsules and triangles overlap the same way they were added */
+typedef struct {
+    int8_t capsule; // 1 for a run of capsule instances, 0 for a run of triangles
+    uint32_t first; // first vertex or instance of the run
+} turtle_batch_t;
 
 typedef struct {
     GLFWwindow* window; // the window
@@ -39,10 +47,23 @@ typedef struct {
     double y;
     list_t *penPos; // a list of where to draw
     bufferList_t *bufferList; // data passed to glBufferData
+    bufferList_t *capsuleList; // capsule instances (joint dots and limbs) passed to the capsule shader
+    turtle_batch_t *batches; // order to draw triangles and capsules in
+    uint32_t batchCount;
+    uint32_t batchCapacity;
+    uint32_t shaderProgram; // triangle shader
+    uint32_t VAO;
+    uint32_t VBO;
+    uint32_t capsuleProgram; // capsule shader
+    uint32_t capsuleVAO;
+    uint32_t capsuleQuadVBO; // unit quad shared by every capsule
+    uint32_t capsuleVBO; // one capsule per instance
+    int32_t capsuleScale; // uniform locations
+    int32_t capsulePixel;
     uint64_t penHash; // the penPos list is hashed and this hash is used to determine if any changes occured between frames
     uint32_t lastLength; // the penPos list's length is saved and if it is different from last frame we know we have to redraw
     char pen; // pen status (1 for down, 0 for up)
-    char penshape; // 0 for circle, 1 for square, 2 for triangle
+    int8_t penshape; // 0 for circle, 1 for square, 2 for triangle
     char close; // close changes to 1 when the user clicks the x on the window
     char shouldClose; // controls whether the window terminates on turtle.close
     double circleprez; // how precise circles are (specifically, the number of sides of a circle with diameter e)
@@ -86,6 +107,96 @@ const char *turtleFragmentShaderSource =
     "    }\n"
     "}\0";
 
+/* capsules are a quad per instance stretched around a segment (a dot is a segment with no length), the fragment shader fades the edge over a pixel using the distance to the segment */
+const char *turtleCapsuleVertexShaderSource =
+    "#version 330 core\n"
+    "layout(location = 0) in vec2 corner;\n"
+    "layout(location = 1) in vec4 ends;\n"
+    "layout(location = 2) in float radius;\n"
+    "layout(location = 3) in vec4 color;\n"
+    "uniform vec2 scale;\n"
+    "uniform float pixel;\n"
+    "out vec2 position;\n"
+    "flat out vec4 segment;\n"
+    "flat out float capsuleRadius;\n"
+    "flat out vec4 shadeColor;\n"
+    "void main() {\n"
+    "    vec2 axis = ends.zw - ends.xy;\n"
+    "    float axisLength = length(axis);\n"
+    "    vec2 along = axisLength > 0.0 ? axis / axisLength : vec2(1.0, 0.0);\n"
+    "    vec2 across = vec2(-along.y, along.x);\n"
+    "    float reach = radius + pixel;\n"
+    "    position = (ends.xy + ends.zw) * 0.5 + along * corner.x * (axisLength * 0.5 + reach) + across * corner.y * reach;\n"
+    "    gl_Position = vec4(position * scale, 0.0, 1.0);\n"
+    "    segment = ends;\n"
+    "    capsuleRadius = radius;\n"
+    "    shadeColor = color;\n"
+    "}\0";
+const char *turtleCapsuleFragmentShaderSource =
+    "#version 330 core\n"
+    "uniform float pixel;\n"
+    "in vec2 position;\n"
+    "flat in vec4 segment;\n"
+    "flat in float capsuleRadius;\n"
+    "flat in vec4 shadeColor;\n"
+    "out vec4 fragColor;\n"
+    "void main() {\n"
+    "    vec2 axis = segment.zw - segment.xy;\n"
+    "    float along = clamp(dot(position - segment.xy, axis) / max(dot(axis, axis), 1e-12), 0.0, 1.0);\n"
+    "    float distance = length(position - segment.xy - axis * along);\n"
+    "    float coverage = clamp((capsuleRadius - distance) / pixel + 0.5, 0.0, 1.0);\n"
+    "    if (coverage <= 0.0) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    fragColor = vec4(shadeColor.rgb, shadeColor.a * coverage);\n"
+    "}\0";
+
+/* compiles and links a shader program, printing any errors */
+uint32_t turtleShaderProgram(const char *vertexSource, const char *fragmentSource) {
+    int32_t vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexSource, NULL);
+    glCompileShader(vertexShader);
+    char errorMessage[512];
+    int32_t success;
+    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(vertexShader, 512, NULL, errorMessage);
+        printf("Error compiling vertex shader\n");
+        printf("%s\n", errorMessage);
+    }
+    int32_t fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        glGetShaderInfoLog(fragmentShader, 512, NULL, errorMessage);
+        printf("Error compiling fragment shader\n");
+        printf("%s\n", errorMessage);
+    }
+    int32_t shaderProgram = glCreateProgram();
+    glAttachShader(shaderProgram, vertexShader);
+    glAttachShader(shaderProgram, fragmentShader);
+    glLinkProgram(shaderProgram);
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(shaderProgram, 512, NULL, errorMessage);
+        printf("Error linking shaders\n");
+        printf("%s\n", errorMessage);
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    return shaderProgram;
+}
+
+/* points the capsule instance attributes (of the bound capsule VAO) at capsule first onwards */
+void turtleCapsuleAttributes(uint32_t first) {
+    size_t offset = sizeof(float) * TURTLE_CAPSULE_SIZE * first;
+    glBindBuffer(GL_ARRAY_BUFFER, turtle.capsuleVBO);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(float) * TURTLE_CAPSULE_SIZE, (void *) offset); // ends attribute
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(float) * TURTLE_CAPSULE_SIZE, (void *) (offset + 4 * sizeof(float))); // radius attribute
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(float) * TURTLE_CAPSULE_SIZE, (void *) (offset + 5 * sizeof(float))); // color attribute
+}
+
 /* run this to set the bounds of the window in coordinates */
 void turtleSetWorldCoordinates(int32_t minX, int32_t minY, int32_t maxX, int32_t maxY) {
     glfwGetWindowSize(turtle.window, &turtle.screenbounds[0], &turtle.screenbounds[1]);
@@ -192,13 +303,11 @@ void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, in
     }
 
     /* set up shaders */
-    uint32_t VAO;
-    glGenVertexArrays(1, &VAO);
-    glBindVertexArray(VAO);
+    glGenVertexArrays(1, &turtle.VAO);
+    glBindVertexArray(turtle.VAO);
 
-    uint32_t VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glGenBuffers(1, &turtle.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, turtle.VBO);
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * BUFFER_OBJECT_SIZE, (void *) 0); // position attribute
@@ -207,41 +316,34 @@ void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, in
     glEnableVertexAttribArray(2);
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(float) * BUFFER_OBJECT_SIZE, (void *) (6 * sizeof(float))); // texture coordinate attribute
 
-    int32_t vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &turtleVertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    char errorMessage[512];
-    int32_t success;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, errorMessage);
-        printf("Error compiling vertex shader\n");
-        printf("%s\n", errorMessage);
-    }
-    int32_t fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &turtleFragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, errorMessage);
-        printf("Error compiling fragment shader\n");
-        printf("%s\n", errorMessage);
-    }
-    int32_t shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shaderProgram, 512, NULL, errorMessage);
-        printf("Error linking shaders\n");
-        printf("%s\n", errorMessage);
-    }
-    
-    glUseProgram(shaderProgram);
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    glDeleteProgram(shaderProgram);
+    turtle.shaderProgram = turtleShaderProgram(turtleVertexShaderSource, turtleFragmentShaderSource);
+
+    /* capsules: a unit quad shared by every instance and a buffer of instances */
+    glGenVertexArrays(1, &turtle.capsuleVAO);
+    glBindVertexArray(turtle.capsuleVAO);
+    float quad[8] = {-1, -1, 1, -1, -1, 1, 1, 1};
+    glGenBuffers(1, &turtle.capsuleQuadVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, turtle.capsuleQuadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 2, (void *) 0); // corner attribute
+
+    glGenBuffers(1, &turtle.capsuleVBO);
+    glEnableVertexAttribArray(1);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribDivisor(2, 1);
+    glEnableVertexAttribArray(3);
+    glVertexAttribDivisor(3, 1);
+    turtleCapsuleAttributes(0);
+
+    turtle.capsuleProgram = turtleShaderProgram(turtleCapsuleVertexShaderSource, turtleCapsuleFragmentShaderSource);
+    turtle.capsuleScale = glGetUniformLocation(turtle.capsuleProgram, "scale");
+    turtle.capsulePixel = glGetUniformLocation(turtle.capsuleProgram, "pixel");
+
+    glBindVertexArray(turtle.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, turtle.VBO);
+    glUseProgram(turtle.shaderProgram);
 
     glEnable(GL_ALPHA);
     glEnable(GL_BLEND);
@@ -255,6 +357,10 @@ void turtleInit(GLFWwindow* window, int32_t minX, int32_t minY, int32_t maxX, in
     turtle.lastscreenbounds[1] = 0;
     turtle.penPos = list_init();
     turtle.bufferList = bufferList_init();
+    turtle.capsuleList = bufferList_init();
+    turtle.batchCount = 0;
+    turtle.batchCapacity = 16;
+    turtle.batches = malloc(sizeof(turtle_batch_t) * turtle.batchCapacity);
     turtle.x = 0;
     turtle.y = 0;
     turtle.pensize = 1;
@@ -441,8 +547,37 @@ void turtleGoto(double x, double y) {
     }
 }
 
+/* starts a new run if the last one was of the other kind (capsule is 1 for capsules, 0 for triangles) */
+void turtleBatch(int8_t capsule) {
+    if (turtle.batchCount > 0 && turtle.batches[turtle.batchCount - 1].capsule == capsule) {
+        return;
+    }
+    if (turtle.batchCount >= turtle.batchCapacity) {
+        turtle.batchCapacity *= 2;
+        turtle.batches = realloc(turtle.batches, sizeof(turtle_batch_t) * turtle.batchCapacity);
+    }
+    turtle.batches[turtle.batchCount].capsule = capsule;
+    turtle.batches[turtle.batchCount].first = capsule ? turtle.capsuleList -> length / TURTLE_CAPSULE_SIZE : turtle.bufferList -> length / BUFFER_OBJECT_SIZE;
+    turtle.batchCount++;
+}
+
+/* adds a capsule from (x1, y1) to (x2, y2) with radius rad (coordinates), a joint dot is a capsule with both ends at the same place */
+void turtleCapsuleRender(double x1, double y1, double x2, double y2, double rad, double r, double g, double b, double a) {
+    turtleBatch(1);
+    bufferList_append(turtle.capsuleList, x1);
+    bufferList_append(turtle.capsuleList, y1);
+    bufferList_append(turtle.capsuleList, x2);
+    bufferList_append(turtle.capsuleList, y2);
+    bufferList_append(turtle.capsuleList, rad);
+    bufferList_append(turtle.capsuleList, r);
+    bufferList_append(turtle.capsuleList, g);
+    bufferList_append(turtle.capsuleList, b);
+    bufferList_append(turtle.capsuleList, a);
+}
+
 /* function to add a vertex to the turtle.bufferList */
 void addVertex(double x, double y, double r, double g, double b, double a, double tx, double ty, double useTexture) {
+    turtleBatch(0);
     bufferList_append(turtle.bufferList, x);
     bufferList_append(turtle.bufferList, y);
     bufferList_append(turtle.bufferList, r);
@@ -454,22 +589,18 @@ void addVertex(double x, double y, double r, double g, double b, double a, doubl
     bufferList_append(turtle.bufferList, useTexture);
 }
 
-/* draws a circle at the specified x and y (coordinates) */
-void turtleCircleRender(double x, double y, double rad, double r, double g, double b, double a, double xfact, double yfact, double prez) {
-    int32_t p = (int32_t) prez;
-    if (p > 0) {
-        // p--;
-        float originX = x * xfact;
-        float originY = (y + rad) * yfact;
+/* draws a circle at the specified x and y (coordinates) with sides sides (see turtleCircleSides) */
+void turtleCircleRender(double x, double y, double rad, double r, double g, double b, double a, double xfact, double yfact, int32_t sides) {
+    if (sides < 3 || sides > TURTLE_CIRCLE_MAX_SIDES) {
+        return;
+    }
+    const float *unit = turtleCircleUnit(sides);
+    float originX = x * xfact;
+    float originY = (y + rad) * yfact;
+    for (int32_t i = 1; i + 1 < sides; i++) {
         addVertex(originX, originY, r, g, b, a, 0, 0, 0);
-        addVertex((x + rad * sin(2 * 1 * M_PI / prez)) * xfact, (y + rad * cos(2 * 1 * M_PI / prez)) * yfact, r, g, b, a, 0, 0, 0);
-        int32_t i = 0;
-        for (; i < p; i++) {
-            addVertex((x + rad * sin(2 * i * M_PI / prez)) * xfact, (y + rad * cos(2 * i * M_PI / prez)) * yfact, r, g, b, a, 0, 0, 0);
-            addVertex(originX, originY, r, g, b, a, 0, 0, 0);
-            addVertex(turtle.bufferList -> data[turtle.bufferList -> length - BUFFER_OBJECT_SIZE * 2], turtle.bufferList -> data[turtle.bufferList -> length - BUFFER_OBJECT_SIZE * 2 + 1], r, g, b, a, 0, 0, 0);
-        }
-        addVertex((x + rad * sin(2 * i * M_PI / prez)) * xfact, (y + rad * cos(2 * i * M_PI / prez)) * yfact, r, g, b, a, 0, 0, 0);
+        addVertex((x + rad * unit[i * 2]) * xfact, (y + rad * unit[i * 2 + 1]) * yfact, r, g, b, a, 0, 0, 0);
+        addVertex((x + rad * unit[i * 2 + 2]) * xfact, (y + rad * unit[i * 2 + 3]) * yfact, r, g, b, a, 0, 0, 0);
     }
 }
 
@@ -683,7 +814,7 @@ void turtleUpdate() {
     char changed = 0;
     uint32_t len = turtle.penPos -> length;
     unitype *ren = turtle.penPos -> data;
-    char *renType = turtle.penPos -> type;
+    int8_t *renType = turtle.penPos -> type;
     unsigned long long oldHash = turtle.penHash;
     turtle.penHash = 0; // I don't use this but it's an idea: https://stackoverflow.com/questions/57455444/very-low-collision-non-cryptographic-hashing-function
     for (uint32_t i = 0; i < len; i++) {
@@ -696,67 +827,46 @@ void turtleUpdate() {
     }
     if (changed) {
         turtle.bufferList -> length = 0;
+        turtle.capsuleList -> length = 0;
+        turtle.batchCount = 0;
+        int8_t previousConnected = 0; // whether the last pen position was joined to this one
         double xfact = (turtle.bounds[2] - turtle.bounds[0]) / 2;
         double yfact = (turtle.bounds[3] - turtle.bounds[1]) / 2;
         xfact = 1 / xfact;
         yfact = 1 / yfact;
-        double lastSize = -1;
-        double lastPrez = -1;
-        double precomputedLog = 5;
         for (int32_t i = 0; i < (int32_t) len; i += 9) {
             if (renType[i] == 'd') {
+                int8_t connected = i + 9 < (int32_t) len && renType[i + 9] == 'd' && ren[i + 7].h < 64 && (ren[i + 7].h == 4 || ren[i + 7].h == 5 || (fabs(ren[i].d - ren[i + 9].d) > ren[i + 2].d / 2 || fabs(ren[i + 1].d - ren[i + 10].d) > ren[i + 2].d / 2)); // tests for next point continuity and also ensures that the next point is at sufficiently different coordinates
+                int8_t round = ren[i + 7].h == 0 || ren[i + 7].h == 5; // round pens are drawn with capsules, the round ends of the limbs fill in the joints
+                if (round && !connected && !previousConnected) {
+                    turtleCapsuleRender(ren[i].d, ren[i + 1].d, ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d);
+                }
                 switch (ren[i + 7].h) {
-                    case 0:
-                    if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d))
-                        precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                    lastSize = ren[i + 2].d;
-                    lastPrez = ren[i + 8].d;
-                    turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    break;
                     case 1:
                     turtleSquareRender(ren[i].d - ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d + ren[i + 2].d, ren[i + 1].d + ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
                     break;
                     case 2:
                     turtleTriangleRender(ren[i].d - ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d + ren[i + 2].d, ren[i + 1].d - ren[i + 2].d, ren[i].d, ren[i + 1].d + ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
                     break;
-                    case 5:
-                    if (i - 9 < 0 || renType[i - 9] == 'c') {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d))
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
-                    break;
                 }
-                if (i + 9 < (int32_t) len && renType[i + 9] == 'd' && ren[i + 7].h < 64 && (ren[i + 7].h == 4 || ren[i + 7].h == 5 || (fabs(ren[i].d - ren[i + 9].d) > ren[i + 2].d / 2 || fabs(ren[i + 1].d - ren[i + 10].d) > ren[i + 2].d / 2))) { // tests for next point continuity and also ensures that the next point is at sufficiently different coordinates
+                if (connected && round) {
+                    turtleCapsuleRender(ren[i].d, ren[i + 1].d, ren[i + 9].d, ren[i + 10].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d);
+                } else if (connected) {
                     double dir = atan((ren[i + 9].d - ren[i].d) / (ren[i + 1].d - ren[i + 10].d));
                     double sinn = sin(dir + M_PI / 2);
                     double coss = cos(dir + M_PI / 2);
                     turtleQuadRender(ren[i].d + ren[i + 2].d * sinn, ren[i + 1].d - ren[i + 2].d * coss, ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i].d - ren[i + 2].d * sinn, ren[i + 1].d + ren[i + 2].d * coss, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact);
-                    if ((ren[i + 7].h == 4 || ren[i + 7].h == 5) && i + 18 < (int32_t) len && renType[i + 18] == 'd') {
+                    if (ren[i + 7].h == 4 && i + 18 < (int32_t) len && renType[i + 18] == 'd') {
                         double dir2 = atan((ren[i + 18].d - ren[i + 9].d) / (ren[i + 10].d - ren[i + 19].d));
                         double sinn2 = sin(dir2 + M_PI / 2);
                         double coss2 = cos(dir2 + M_PI / 2);
                         turtleTriangleRender(ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i + 9].d + ren[i + 11].d * sinn2, ren[i + 10].d - ren[i + 11].d * coss2, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact); // in a perfect world the program would know which one of these triangles to render (to blend the segments)
                         turtleTriangleRender(ren[i + 9].d + ren[i + 2].d * sinn, ren[i + 10].d - ren[i + 2].d * coss, ren[i + 9].d - ren[i + 2].d * sinn, ren[i + 10].d + ren[i + 2].d * coss, ren[i + 9].d - ren[i + 11].d * sinn2, ren[i + 10].d + ren[i + 11].d * coss2, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact); // however we live in a world where i am bad at math, so it just renders both no matter what (one has no effect)
                     }
-                } else {
-                    if (ren[i + 7].h == 4 && i > 8 && renType[i - 8] == 'c') {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d))
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
-                    if (ren[i + 7].h == 5 && i > 8) {
-                        if (!(lastSize == ren[i + 2].d) || !(lastPrez != ren[i + 8].d))
-                            precomputedLog = ren[i + 8].d * log(2.71 + ren[i + 2].d);
-                        lastSize = ren[i + 2].d;
-                        lastPrez = ren[i + 8].d;
-                        turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, precomputedLog);
-                    }
+                } else if (ren[i + 7].h == 4 && i > 8 && renType[i - 8] == 'c') {
+                    turtleCircleRender(ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 4].d, ren[i + 5].d, ren[i + 6].d, xfact, yfact, turtleCircleSides(ren[i + 8].d, ren[i + 2].d, 0));
                 }
+                previousConnected = connected;
                 if (ren[i + 7].h == 64) { // blit circle
 
                 }
@@ -771,12 +881,36 @@ void turtleUpdate() {
                 if (ren[i + 7].h >= 128) { // blit texture (rectangle)
                     turtleTextureRender(ren[i + 7].h - 128, ren[i].d, ren[i + 1].d, ren[i + 2].d, ren[i + 3].d, ren[i + 5].d, ren[i + 6].d, ren[i + 8].d, ren[i + 4].d / 57.2958, xfact, yfact);
                 }
+            } else {
+                previousConnected = 0;
             }
         }
         // printf("len: %d\n", turtle.bufferList -> length / BUFFER_OBJECT_SIZE); // print number of triangles
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBindBuffer(GL_ARRAY_BUFFER, turtle.VBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * turtle.bufferList -> length, turtle.bufferList -> data, GL_STATIC_DRAW);
-        glDrawArrays(GL_TRIANGLES, 0, turtle.bufferList -> length / BUFFER_OBJECT_SIZE);
+        glBindBuffer(GL_ARRAY_BUFFER, turtle.capsuleVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * turtle.capsuleList -> length, turtle.capsuleList -> data, GL_STATIC_DRAW);
+        /* runs alternate between triangles and capsules, so a run ends where the run after next begins */
+        double pixel = turtle.screenbounds[0] > 0 ? (double) (turtle.bounds[2] - turtle.bounds[0]) / turtle.screenbounds[0] : 1;
+        glUseProgram(turtle.capsuleProgram);
+        glUniform2f(turtle.capsuleScale, xfact, yfact);
+        glUniform1f(turtle.capsulePixel, pixel);
+        for (uint32_t i = 0; i < turtle.batchCount; i++) {
+            turtle_batch_t *batch = &turtle.batches[i];
+            if (batch -> capsule) {
+                uint32_t end = i + 2 < turtle.batchCount ? turtle.batches[i + 2].first : turtle.capsuleList -> length / TURTLE_CAPSULE_SIZE;
+                glUseProgram(turtle.capsuleProgram);
+                glBindVertexArray(turtle.capsuleVAO);
+                turtleCapsuleAttributes(batch -> first); // there is no base instance before OpenGL 4.2, so the instance attributes are pointed at the first capsule of the run instead
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, end - batch -> first);
+            } else {
+                uint32_t end = i + 2 < turtle.batchCount ? turtle.batches[i + 2].first : turtle.bufferList -> length / BUFFER_OBJECT_SIZE;
+                glUseProgram(turtle.shaderProgram);
+                glBindVertexArray(turtle.VAO);
+                glDrawArrays(GL_TRIANGLES, batch -> first, end - batch -> first);
+            }
+        }
         glfwSwapBuffers(turtle.window);
     }
     glfwPollEvents();
@@ -802,5 +936,15 @@ void turtleFree() {
     list_free(turtle.keyPressed);
     list_free(turtle.penPos);
     bufferList_free(turtle.bufferList);
+    bufferList_free(turtle.capsuleList);
+    free(turtle.batches);
+    glDeleteProgram(turtle.shaderProgram);
+    glDeleteVertexArrays(1, &turtle.VAO);
+    glDeleteBuffers(1, &turtle.VBO);
+    glDeleteProgram(turtle.capsuleProgram);
+    glDeleteVertexArrays(1, &turtle.capsuleVAO);
+    glDeleteBuffers(1, &turtle.capsuleQuadVBO);
+    glDeleteBuffers(1, &turtle.capsuleVBO);
+    turtleCircleFree();
 }
 #endif
\ No newline at end of file
@@ -1,6 +1,14 @@
 #include "include/turtleTools.h"
 #include "include/osTools.h"
-#include <time.h>
+#include "include/stickKinematics.h"
+#include "include/stickShader.h"
+#include "include/spatialGrid.h"
+#include "include/turtleRaster.h"
+#include "include/imageEncode.h"
+#ifdef OS_WINDOWS
+#include <io.h> // _setmode, for binary stdout
+#include <fcntl.h>
+#endif
 
 /*
 TODO:
@@ -11,7 +19,6 @@ TODO:
 - reorder frames?
 - rotate entire stick?
 - fix bug with loading causing an extra frame (or erasing the last frame?)
-- binding keys to animations?
 */
 
 typedef enum {
@@ -28,29 +35,90 @@ typedef enum {
     STICK_GREEN = 5,
     STICK_BLUE = 6,
     STICK_ALPHA = 7,
-    STICK_LOWER_BODY = 16,
-    STICK_UPPER_BODY = 17,
-    STICK_HEAD = 18,
-    STICK_LEFT_UPPER_ARM = 19,
-    STICK_LEFT_LOWER_ARM = 20,
-    STICK_RIGHT_UPPER_ARM = 21,
-    STICK_RIGHT_LOWER_ARM = 22,
-    STICK_LEFT_UPPER_LEG = 23,
-    STICK_LEFT_LOWER_LEG = 24,
-    STICK_RIGHT_UPPER_LEG = 25,
-    STICK_RIGHT_LOWER_LEG = 26,
+    STICK_ANGLES = 16, // angle of each joint of the rig follows (in rig order)
 } stick_index_t;
 
+#define CLIP_BINDINGS 9 // number keys 1 - 9 can be bound to animations
+#define CLIP_LAYERS 4 // maximum number of additive layers
+
+/* playback state of an animation driven by the clip player */
+typedef struct {
+    int32_t animationIndex; // index in self.animations, -1 if inactive
+    int32_t frame; // current frame of the animation
+    double x; // accumulated position (clips move the stick from wherever they were started)
+    double y;
+    double weight; // weight of an additive layer
+    double timeOfLastFrame;
+} clip_state_t;
+
+/* cached forward kinematics of a live stick, static sticks are drawn without recomputing any sin or cos */
+typedef struct {
+    int8_t anglesChanged; // sin and cos of the angles need to be recomputed
+    int8_t moved; // joint positions need to be recomputed
+    stick_batch_t *batch; // one pose batch holding the sin, cos and joint positions
+} stick_cache_t;
+
+#define THUMBNAIL_CACHE_SIZE 1024 // power of two
+#define THUMBNAIL_CACHE_WAYS 4 // a pose can be in any of this many entries after the one its hash maps to
+#define STYLE_VALUES 10 // values written by styleValues
+
+/* pen records of a thumbnail, drawn once and then copied into turtle.penPos each tick */
+typedef struct {
+    uint64_t hash; // thumbnailHash of the pose, 0 if the entry is empty
+    turtle_buffer_t *geometry; // turtle.penPos records with positions relative to the stick's position
+} thumbnail_t;
+
+#define PREVIEW_FRAMES_PER_SECOND 4 // rate of sidebar previews that are not hovered
+#define PREVIEW_UPDATES_PER_TICK 2 // most previews that advance in one tick (spreads them over ticks instead of all updating together)
+
+/* sidebar preview of an animation */
+typedef struct {
+    int32_t frame; // frame shown
+    double x; // position of the stick at frame (animations store changes in position)
+    double y;
+    double timeOfLastFrame;
+} preview_t;
+
 typedef enum {
-    STICK_SIZE_LOWER_BODY = 22,
-    STICK_SIZE_UPPER_BODY = 22,
-    STICK_SIZE_HEAD_RADIUS = 17,
-    STICK_SIZE_HEAD = 15,
-    STICK_SIZE_UPPER_ARM = 28,
-    STICK_SIZE_LOWER_ARM = 28,
-    STICK_SIZE_UPPER_LEG = 35,
-    STICK_SIZE_LOWER_LEG = 35,
-} stick_relative_sizes_t;
+    EXPORT_PNG = 0, // numbered PNG files
+    EXPORT_Y4M = 1, // raw YUV 4:2:0 video, to a file or stdout
+    EXPORT_GIF = 2, // animated GIF
+    EXPORT_APNG = 3, // animated PNG
+} export_format_t;
+
+/* frame of an export, tessellated on the main thread, drawn and encoded by a worker thread and then written out in order */
+typedef struct {
+    int32_t frame; // index in currentAnimation
+    turtle_vertex_t *vertices;
+    uint32_t vertexCount;
+    uint32_t vertexCapacity;
+    uint32_t *indices;
+    uint32_t indexCount;
+    uint32_t indexCapacity;
+    uint8_t *indexed; // palette index of each pixel (GIF and APNG)
+    image_buffer_t encoded; // the frame as it is written (a PNG file, a Y4M frame, or a GIF or APNG frame)
+} export_frame_t;
+
+/* shared by the threads of an export */
+typedef struct {
+    export_format_t format;
+    const char *target; // prefix of PNG files (prefix0000.png...), or the file of any other format ("-" for stdout)
+    FILE *stream; // output of every format other than PNG
+    int32_t width;
+    int32_t height;
+    export_frame_t *drawing; // frames being drawn and encoded
+    export_frame_t *writing; // frames before them, being written at the same time
+    int32_t writeCount;
+    uint8_t palette[768]; // colours of GIF and APNG frames
+    int32_t colors;
+    turtle_raster_t **rasters; // one for each thread
+    int32_t failed; // set if the output could not be written
+} export_job_t;
+
+typedef enum {
+    TIME_SOURCE_REALTIME = 0, // wall clock
+    TIME_SOURCE_OFFLINE = 1, // every tick advances by exactly one frame (1 / framesPerSecond), for deterministic rendering
+} time_source_t;
 
 typedef struct {
     /* list of sticks */
@@ -58,19 +126,19 @@ typedef struct {
     /* stick format 
     [
         [positionX, positionY, size, style, red, green, blue, alpha, reserved, reserved, reserved, reserved, reserved, reserved, reserved, reserved
-        lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg]
+        angle of each joint in the rig (for the default rig: lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg)]
     ]
     */
     list_t *currentAnimation;
     /* currentAnimation format 
     [
-        [positionX, positionY, lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg]
+        [positionX, positionY, angle of each joint in the rig]
     ]
     */
     list_t *animations;
     /* animations format
     [
-        [filepath, name, number of frames, startingX, startingY, frames per second, reserved, reserved,
+        [filepath, name, number of frames, startingX, startingY, frames per second, angle space (0 - bearings, 1 - relative to the parent joint), reserved,
             [changeX, changeY, lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg
             changeX, changeY, lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg
             changeX, changeY, lower body, upper body, head, left upper arm, left lower arm, right upper arm, right lower arm, left upper leg, left lower leg, right upper leg, right lower leg
@@ -79,9 +147,15 @@ typedef struct {
         ]
     ]
     */
-    list_t *dotPositions;
-    list_t *limbParents;
-    list_t *limbChildren;
+    spatial_grid_t *dotGrid; // dots of every stick for picking, dot row of stick i has id i * (STICK_MAX_JOINTS + 1) + row (row 0 is the stick's position, row j + 1 is the end of joint j)
+    stick_rig_t rig; // joints of every stick, loaded from a rig definition file
+    list_t *stickCaches; // stick_cache_t for each stick in sticks
+    stick_batch_t *thumbnailBatch; // forward kinematics of onions and thumbnails
+    list_t *thumbnailStick; // colour and style of onions and thumbnails
+    thumbnail_t thumbnailCache[THUMBNAIL_CACHE_SIZE]; // thumbnails by pose hash
+    int32_t thumbnailEvict; // round robin choice of which way to replace when they are all full
+    uint64_t *thumbnailMissHash; // hash of the thumbnail in each slot of thumbnailBatch that has to be drawn this tick
+    int32_t thumbnailMisses;
     int8_t keys[16];
     double gridSize;
     double gridBounds[4];
@@ -96,11 +170,28 @@ typedef struct {
     double positionAnchorY;
     int32_t mouseHoverFrame;
     int32_t mouseHoverAnimation;
+    double mouseWheel; // scroll wheel movement this tick, read every tick so that scrolling somewhere else is not applied later
+
+    /* inverse kinematics */
+    int8_t ik; // dragging a dot moves it to the mouse by bending the limbs above it
+    tt_switch_t *ikSwitch;
+    int8_t pinned[STICK_MAX_JOINTS]; // hands and feet that stay in place while the rest of the stick is posed
+    double pinPositions[STICK_MAX_JOINTS * 2];
+    int32_t pinStickIndex; // stick the pins belong to
 
     int8_t mode; // 0 - normal mode, 1 - editing mode
     tt_switch_t *modeSwitch;
-    double onionNumber;
+    double onionNumber; // onions of frames before the current frame
     tt_slider_t *onionSlider;
+    double onionAheadNumber; // onions of frames after the current frame
+    tt_slider_t *onionAheadSlider;
+    turtle_buffer_t *onionGeometry; // turtle.penPos records of the onions, redrawn only when what they were drawn from changes
+    int32_t onionFrame; // currentFrame the onions were drawn around
+    int32_t onionBefore;
+    int32_t onionAhead;
+    uint32_t onionRevision; // frameRevision the onions were drawn at
+    uint64_t onionStyle; // styleHash the onions were drawn with
+    uint32_t frameRevision; // incremented by every change to the frames of currentAnimation
     int8_t frameButtonPressed;
     tt_button_t *frameButton;
     int32_t currentFrame; // number of frame being edited
@@ -108,6 +199,7 @@ typedef struct {
     double frameBarY;
     double frameScroll;
     tt_scrollbar_t *frameScrollbar;
+    double frameWidth; // distance between frames in the timeline (ctrl + scroll wheel zooms)
 
     /* animation */
     int32_t animationSaveIndex;
@@ -115,10 +207,14 @@ typedef struct {
     double animationBarY;
     double animationScroll;
     tt_scrollbar_t *animationScrollbar;
+    preview_t *previews; // preview of each animation in the sidebar
+    int32_t previewCapacity;
+    int8_t previewAnimations; // cycle through the frames of every animation in the sidebar, otherwise only the hovered one
+    int32_t previewCursor; // animation the next round of preview updates starts at (so that every preview gets its turn)
 
     /* playing animation */
     int32_t playingAnimationFrame;
-    clock_t timeOfLastFrame;
+    double timeOfLastFrame;
     int8_t playButtonPressed;
     int8_t play;
     tt_button_t *playButton;
@@ -134,59 +230,71 @@ typedef struct {
     /* advanced play */
     int8_t advancedPlay;
     int32_t advancedFrame;
-    clock_t timeOfLastAdvancedFrame;
+    double timeOfLastAdvancedFrame;
+
+    /* clip player (key bound animations) */
+    int32_t clipBindings[CLIP_BINDINGS]; // animation index bound to each number key
+    int8_t clipKeys[CLIP_BINDINGS];
+    clip_state_t clipBase; // clip that drives the stick
+    clip_state_t clipLayers[CLIP_LAYERS]; // clips added on top of clipBase, or on top of the stick's own pose if no clipBase is playing
+    double clipLayerOffset[STICK_MAX_JOINTS]; // angles the layers added to the stick's own pose last tick (0 while clipBase is playing)
+    double clipLayerPose[STICK_MAX_JOINTS + 2]; // pose the stick was left in last tick with clipLayerOffset added, if it has changed since then something else moved it
+    double clipFromPose[STICK_MAX_JOINTS + 2]; // pose the stick was in when clipBase was triggered
+    double clipBlendStart;
+    double clipBlendMilliseconds; // length of cross-fade between clips
+
+    /* idle mode */
+    int8_t idleMode; // block on events instead of redrawing when nothing can change
+    uint32_t lastEvents; // turtle.events when it was last checked
+    int32_t activeTicks; // ticks left to run after the last event before going idle
+
+    /* GPU sticks */
+    int8_t gpuSticks; // sticks are drawn by stickShader from their poses instead of by the turtle
+    int8_t gpuSticksSupported; // stickShaderInit succeeded
+    stick_shader_t stickShader;
+
+    /* time */
+    time_source_t timeSource;
+    double timeNow; // seconds, all timing reads this instead of the clock
 } stickAnimator_t;
 
 stickAnimator_t self;
 
 void createStick(list_t *stick);
+void stickChanged(int32_t stickIndex);
+void stickMoved(int32_t stickIndex);
 void insertFrame(int32_t stickIndex, int32_t frameIndex);
+void getStickPose(int32_t stickIndex, double *pose);
+void setStickPose(int32_t stickIndex, double *pose);
 void generateAnimation(char *filename, int32_t animationIndex);
 
-void init() {
+int32_t init(const char *rigFilename) {
+    /* load rig */
+    if (stickRigLoad(&self.rig, rigFilename) == -1) {
+        return -1;
+    }
     self.sticks = list_init();
     /* create default stick */
     list_t *defaultStick = list_init();
     createStick(defaultStick);
     list_append(self.sticks, (unitype) defaultStick, 'r');
-    /* create limb tree */
-    self.limbParents = list_init();
-    self.dotPositions = list_init();
-    self.limbChildren = list_init();
-    for (int32_t i = 0; i < 64; i++) {
-        list_append(self.dotPositions, (unitype) 0.0, 'd');
-        list_append(self.limbParents, (unitype) 0, 'i');
-        list_append(self.limbChildren, (unitype) list_init(), 'r');
-    }
-    self.limbParents -> data[STICK_LOWER_BODY].i = 0;
-    self.limbParents -> data[STICK_UPPER_BODY].i = STICK_LOWER_BODY;
-    self.limbParents -> data[STICK_HEAD].i = STICK_UPPER_BODY;
-    self.limbParents -> data[STICK_LEFT_UPPER_ARM].i = STICK_UPPER_BODY;
-    self.limbParents -> data[STICK_RIGHT_UPPER_ARM].i = STICK_UPPER_BODY;
-    self.limbParents -> data[STICK_LEFT_LOWER_ARM].i = STICK_LEFT_UPPER_ARM;
-    self.limbParents -> data[STICK_RIGHT_LOWER_ARM].i = STICK_RIGHT_UPPER_ARM;
-    self.limbParents -> data[STICK_LEFT_UPPER_LEG].i = 0;
-    self.limbParents -> data[STICK_RIGHT_UPPER_LEG].i = 0;
-    self.limbParents -> data[STICK_LEFT_LOWER_LEG].i = STICK_LEFT_UPPER_LEG;
-    self.limbParents -> data[STICK_RIGHT_LOWER_LEG].i = STICK_RIGHT_UPPER_LEG;
-
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_UPPER_BODY, 'i');
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_HEAD, 'i');
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_LEFT_UPPER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_RIGHT_UPPER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_LEFT_LOWER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_LOWER_BODY].r, (unitype) STICK_RIGHT_LOWER_ARM, 'i');
-
-    list_append(self.limbChildren -> data[STICK_UPPER_BODY].r, (unitype) STICK_HEAD, 'i');
-    list_append(self.limbChildren -> data[STICK_UPPER_BODY].r, (unitype) STICK_LEFT_UPPER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_UPPER_BODY].r, (unitype) STICK_RIGHT_UPPER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_UPPER_BODY].r, (unitype) STICK_LEFT_LOWER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_UPPER_BODY].r, (unitype) STICK_RIGHT_LOWER_ARM, 'i');
-
-    list_append(self.limbChildren -> data[STICK_LEFT_UPPER_ARM].r, (unitype) STICK_LEFT_LOWER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_RIGHT_UPPER_ARM].r, (unitype) STICK_RIGHT_LOWER_ARM, 'i');
-    list_append(self.limbChildren -> data[STICK_LEFT_UPPER_LEG].r, (unitype) STICK_LEFT_LOWER_LEG, 'i');
-    list_append(self.limbChildren -> data[STICK_RIGHT_UPPER_LEG].r, (unitype) STICK_RIGHT_LOWER_LEG, 'i');
+    self.stickCaches = list_init();
+    stick_cache_t *defaultCache = malloc(sizeof(stick_cache_t));
+    defaultCache -> anglesChanged = 1;
+    defaultCache -> moved = 1;
+    defaultCache -> batch = stickBatchInit();
+    list_append(self.stickCaches, (unitype) (void *) defaultCache, 'p');
+    self.dotGrid = spatialGridInit(8, 1024);
+    self.thumbnailBatch = stickBatchInit();
+    self.thumbnailStick = list_init();
+    createStick(self.thumbnailStick);
+    for (int32_t i = 0; i < THUMBNAIL_CACHE_SIZE; i++) {
+        self.thumbnailCache[i].hash = 0;
+        self.thumbnailCache[i].geometry = turtleBufferInit();
+    }
+    self.thumbnailEvict = 0;
+    self.thumbnailMissHash = NULL;
+    self.thumbnailMisses = 0;
 
     self.currentAnimation = list_init();
     insertFrame(0, 0);
@@ -196,6 +304,7 @@ void init() {
     self.mouseAnchorY = 0;
     self.mouseHoverFrame = -1;
     self.mouseHoverAnimation = -1;
+    self.mouseWheel = 0;
 
     /* UI elements */
     self.gridSize = 8;
@@ -214,7 +323,12 @@ void init() {
     self.mode = 1;
     self.modeSwitch = switchInit("Mode", &self.mode, -305, 152, 6);
     self.onionNumber = 0;
-    self.onionSlider = sliderInit("Onion", &self.onionNumber, TT_SLIDER_HORIZONTAL, TT_SLIDER_ALIGN_CENTER, -286, 100, 6, 40, 0, 3, 1);
+    self.onionSlider = sliderInit("Onion", &self.onionNumber, TT_SLIDER_HORIZONTAL, TT_SLIDER_ALIGN_CENTER, -286, 100, 6, 40, 0, 24, 1);
+    self.onionAheadNumber = 0;
+    self.onionAheadSlider = sliderInit("Ahead", &self.onionAheadNumber, TT_SLIDER_HORIZONTAL, TT_SLIDER_ALIGN_CENTER, -230, 100, 6, 40, 0, 24, 1);
+    self.onionGeometry = turtleBufferInit();
+    self.onionFrame = -1;
+    self.frameRevision = 0;
     self.frameButtonPressed = 0;
     self.frameButton = buttonInit("Add Frame", &self.frameButtonPressed, -290, 135, 6);
     self.deleteFrameButtonPressed = 0;
@@ -225,7 +339,11 @@ void init() {
     self.frameBarX = -180;
     self.frameBarY = 160;
     self.frameScroll = 0;
+    self.frameWidth = 66;
     self.frameScrollbar = scrollbarInit(&self.frameScroll, TT_SCROLLBAR_HORIZONTAL, (self.frameBarX + 315) / 2, self.frameBarY - 41, 6, 492, 90);
+    self.ik = 0;
+    self.pinStickIndex = 0;
+    self.ikSwitch = switchInit("IK", &self.ik, -245, 135, 6);
     self.playButtonPressed = 0;
     self.play = 0;
     self.playButton = buttonInit("Play", &self.playButtonPressed, -280, 152, 6);
@@ -243,9 +361,55 @@ void init() {
     self.animationBarY = 113;
     self.animationScroll = 0;
     self.animationScrollbar = scrollbarInit(&self.animationScroll, TT_SCROLLBAR_VERTICAL, (self.animationBarX) - 5, (self.animationBarY - 175) / 2, 6, 286, 90);
+    self.previews = NULL;
+    self.previewCapacity = 0;
+    self.previewAnimations = 0;
+    self.previewCursor = 0;
 
     self.advancedPlay = 0;
     self.advancedFrame = 0;
+
+    /* clip player */
+    for (int32_t i = 0; i < CLIP_BINDINGS; i++) {
+        self.clipBindings[i] = i;
+        self.clipKeys[i] = 0;
+    }
+    self.clipBase.animationIndex = -1;
+    for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+        self.clipLayers[i].animationIndex = -1;
+    }
+    self.clipBlendMilliseconds = 200;
+    for (int32_t i = 0; i < STICK_MAX_JOINTS; i++) {
+        self.clipLayerOffset[i] = 0;
+    }
+    for (int32_t i = 0; i < STICK_MAX_JOINTS + 2; i++) {
+        self.clipLayerPose[i] = 0;
+    }
+
+    self.idleMode = 1;
+    self.lastEvents = 0;
+    self.activeTicks = 0;
+
+    self.gpuSticks = 0;
+    self.gpuSticksSupported = 0;
+
+    self.timeSource = TIME_SOURCE_REALTIME;
+    self.timeNow = 0;
+    return 0;
+}
+
+/* advance the time source, call once per tick */
+void timeTick() {
+    if (self.timeSource == TIME_SOURCE_OFFLINE) {
+        self.timeNow += 1.0 / self.framesPerSecond;
+    } else {
+        self.timeNow = glfwGetTime();
+    }
+}
+
+/* returns 1 if at least interval seconds have passed since a time (with tolerance so offline ticks of exactly 1 / fps always count) */
+int8_t timeElapsed(double since, double interval) {
+    return self.timeNow - since >= interval - 1e-9;
 }
 
 /* create stick in default position */
@@ -261,17 +425,22 @@ void createStick(list_t *stick) {
     for (int32_t i = 0; i < 8; i++) {
         list_append(stick, (unitype) 0.0, 'd'); // reserved
     }
-    list_append(stick, (unitype) 5.0, 'd'); // lower body
-    list_append(stick, (unitype) 5.0, 'd'); // upper body
-    list_append(stick, (unitype) 5.0, 'd'); // head
-    list_append(stick, (unitype) -150.0, 'd'); // upper left arm
-    list_append(stick, (unitype) 170.0, 'd'); // lower left arm
-    list_append(stick, (unitype) 170.0, 'd'); // upper right arm
-    list_append(stick, (unitype) 150.0, 'd'); // lower right arm
-    list_append(stick, (unitype) -175.0, 'd'); // upper left leg
-    list_append(stick, (unitype) -170.0, 'd'); // lower left leg
-    list_append(stick, (unitype) 160.0, 'd'); // upper right leg
-    list_append(stick, (unitype) 170.0, 'd'); // lower right leg
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        list_append(stick, (unitype) self.rig.angle[j], 'd'); // angle
+    }
+}
+
+/* mark a stick's angles as edited, its sin and cos are recomputed the next time it is drawn */
+void stickChanged(int32_t stickIndex) {
+    stick_cache_t *cache = self.stickCaches -> data[stickIndex].p;
+    cache -> anglesChanged = 1;
+    cache -> moved = 1;
+}
+
+/* mark a stick's position as edited (angles unchanged) */
+void stickMoved(int32_t stickIndex) {
+    stick_cache_t *cache = self.stickCaches -> data[stickIndex].p;
+    cache -> moved = 1;
 }
 
 /* insert frame to currentAnimation (from stick data) */
@@ -280,18 +449,11 @@ void insertFrame(int32_t stickIndex, int32_t frameIndex) {
     list_t *constructedList = list_init();
     list_append(constructedList, stick -> data[STICK_X], 'd');
     list_append(constructedList, stick -> data[STICK_Y], 'd');
-    list_append(constructedList, stick -> data[STICK_LOWER_BODY], 'd');
-    list_append(constructedList, stick -> data[STICK_UPPER_BODY], 'd');
-    list_append(constructedList, stick -> data[STICK_HEAD], 'd');
-    list_append(constructedList, stick -> data[STICK_LEFT_UPPER_ARM], 'd');
-    list_append(constructedList, stick -> data[STICK_LEFT_LOWER_ARM], 'd');
-    list_append(constructedList, stick -> data[STICK_RIGHT_UPPER_ARM], 'd');
-    list_append(constructedList, stick -> data[STICK_RIGHT_LOWER_ARM], 'd');
-    list_append(constructedList, stick -> data[STICK_LEFT_UPPER_LEG], 'd');
-    list_append(constructedList, stick -> data[STICK_LEFT_LOWER_LEG], 'd');
-    list_append(constructedList, stick -> data[STICK_RIGHT_UPPER_LEG], 'd');
-    list_append(constructedList, stick -> data[STICK_RIGHT_LOWER_LEG], 'd');
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        list_append(constructedList, stick -> data[STICK_ANGLES + j], 'd');
+    }
     list_insert(self.currentAnimation, frameIndex, (unitype) constructedList, 'r');
+    self.frameRevision++;
 }
 
 /* update currentAnimation with data from stick */
@@ -299,17 +461,10 @@ void updateCurrentFrame(int32_t stickIndex, int32_t frameIndex) {
     list_t *stick = self.sticks -> data[stickIndex].r;
     self.currentAnimation -> data[frameIndex].r -> data[0] = stick -> data[STICK_X];
     self.currentAnimation -> data[frameIndex].r -> data[1] = stick -> data[STICK_Y];
-    self.currentAnimation -> data[frameIndex].r -> data[2] = stick -> data[STICK_LOWER_BODY];
-    self.currentAnimation -> data[frameIndex].r -> data[3] = stick -> data[STICK_UPPER_BODY];
-    self.currentAnimation -> data[frameIndex].r -> data[4] = stick -> data[STICK_HEAD];
-    self.currentAnimation -> data[frameIndex].r -> data[5] = stick -> data[STICK_LEFT_UPPER_ARM];
-    self.currentAnimation -> data[frameIndex].r -> data[6] = stick -> data[STICK_LEFT_LOWER_ARM];
-    self.currentAnimation -> data[frameIndex].r -> data[7] = stick -> data[STICK_RIGHT_UPPER_ARM];
-    self.currentAnimation -> data[frameIndex].r -> data[8] = stick -> data[STICK_RIGHT_LOWER_ARM];
-    self.currentAnimation -> data[frameIndex].r -> data[9] = stick -> data[STICK_LEFT_UPPER_LEG];
-    self.currentAnimation -> data[frameIndex].r -> data[10] = stick -> data[STICK_LEFT_LOWER_LEG];
-    self.currentAnimation -> data[frameIndex].r -> data[11] = stick -> data[STICK_RIGHT_UPPER_LEG];
-    self.currentAnimation -> data[frameIndex].r -> data[12] = stick -> data[STICK_RIGHT_LOWER_LEG];
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        self.currentAnimation -> data[frameIndex].r -> data[2 + j] = stick -> data[STICK_ANGLES + j];
+    }
+    self.frameRevision++;
 }
 
 /* update stick with data from the current frame */
@@ -317,17 +472,10 @@ void loadCurrentFrame(int32_t stickIndex) {
     list_t *stick = self.sticks -> data[stickIndex].r;
     stick -> data[STICK_X] = self.currentAnimation -> data[self.currentFrame].r -> data[0];
     stick -> data[STICK_Y] = self.currentAnimation -> data[self.currentFrame].r -> data[1];
-    stick -> data[STICK_LOWER_BODY] = self.currentAnimation -> data[self.currentFrame].r -> data[2];
-    stick -> data[STICK_UPPER_BODY] = self.currentAnimation -> data[self.currentFrame].r -> data[3];
-    stick -> data[STICK_HEAD] = self.currentAnimation -> data[self.currentFrame].r -> data[4];
-    stick -> data[STICK_LEFT_UPPER_ARM] = self.currentAnimation -> data[self.currentFrame].r -> data[5];
-    stick -> data[STICK_LEFT_LOWER_ARM] = self.currentAnimation -> data[self.currentFrame].r -> data[6];
-    stick -> data[STICK_RIGHT_UPPER_ARM] = self.currentAnimation -> data[self.currentFrame].r -> data[7];
-    stick -> data[STICK_RIGHT_LOWER_ARM] = self.currentAnimation -> data[self.currentFrame].r -> data[8];
-    stick -> data[STICK_LEFT_UPPER_LEG] = self.currentAnimation -> data[self.currentFrame].r -> data[9];
-    stick -> data[STICK_LEFT_LOWER_LEG] = self.currentAnimation -> data[self.currentFrame].r -> data[10];
-    stick -> data[STICK_RIGHT_UPPER_LEG] = self.currentAnimation -> data[self.currentFrame].r -> data[11];
-    stick -> data[STICK_RIGHT_LOWER_LEG] = self.currentAnimation -> data[self.currentFrame].r -> data[12];
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        stick -> data[STICK_ANGLES + j] = self.currentAnimation -> data[self.currentFrame].r -> data[2 + j];
+    }
+    stickChanged(stickIndex);
 }
 
 /* update currentAnimation with data from animations */
@@ -342,19 +490,12 @@ void loadCurrentAnimation(int32_t animationIndex) {
         ypos += self.animations -> data[animationIndex].r -> data[8 + i].r -> data[1].d;
         list_append(constructedList, (unitype) xpos, 'd');
         list_append(constructedList, (unitype) ypos, 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[2], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[3], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[4], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[5], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[6], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[7], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[8], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[9], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[10], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[11], 'd');
-        list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[12], 'd');
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            list_append(constructedList, self.animations -> data[animationIndex].r -> data[8 + i].r -> data[2 + j], 'd');
+        }
         list_append(self.currentAnimation, (unitype) constructedList, 'r');
     }
+    self.frameRevision++;
 }
 
 /* put stick in first frame position */
@@ -365,17 +506,10 @@ void loadFirstFrame(int32_t stickIndex, int32_t animationIndex) {
         list_t *animationFirstFrame = animation -> data[8].r;
         stick -> data[STICK_X].d = animation -> data[3].d + animationFirstFrame -> data[0].d;
         stick -> data[STICK_Y].d = animation -> data[4].d + animationFirstFrame -> data[1].d;
-        stick -> data[STICK_LOWER_BODY] = animationFirstFrame -> data[2];
-        stick -> data[STICK_UPPER_BODY] = animationFirstFrame -> data[3];
-        stick -> data[STICK_HEAD] = animationFirstFrame -> data[4];
-        stick -> data[STICK_LEFT_UPPER_ARM] = animationFirstFrame -> data[5];
-        stick -> data[STICK_LEFT_LOWER_ARM] = animationFirstFrame -> data[6];
-        stick -> data[STICK_RIGHT_UPPER_ARM] = animationFirstFrame -> data[7];
-        stick -> data[STICK_RIGHT_LOWER_ARM] = animationFirstFrame -> data[8];
-        stick -> data[STICK_LEFT_UPPER_LEG] = animationFirstFrame -> data[9];
-        stick -> data[STICK_LEFT_LOWER_LEG] = animationFirstFrame -> data[10];
-        stick -> data[STICK_RIGHT_UPPER_LEG] = animationFirstFrame -> data[11];
-        stick -> data[STICK_RIGHT_LOWER_LEG] = animationFirstFrame -> data[12];
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            stick -> data[STICK_ANGLES + j] = animationFirstFrame -> data[2 + j];
+        }
+        stickChanged(stickIndex);
     }
 }
 
@@ -387,17 +521,10 @@ void loadNextFrame(int32_t stickIndex, int32_t animationIndex) {
         list_t *animationFirstFrame = animation -> data[8 + self.advancedFrame].r;
         stick -> data[STICK_X].d += animationFirstFrame -> data[0].d;
         stick -> data[STICK_Y].d += animationFirstFrame -> data[1].d;
-        stick -> data[STICK_LOWER_BODY] = animationFirstFrame -> data[2];
-        stick -> data[STICK_UPPER_BODY] = animationFirstFrame -> data[3];
-        stick -> data[STICK_HEAD] = animationFirstFrame -> data[4];
-        stick -> data[STICK_LEFT_UPPER_ARM] = animationFirstFrame -> data[5];
-        stick -> data[STICK_LEFT_LOWER_ARM] = animationFirstFrame -> data[6];
-        stick -> data[STICK_RIGHT_UPPER_ARM] = animationFirstFrame -> data[7];
-        stick -> data[STICK_RIGHT_LOWER_ARM] = animationFirstFrame -> data[8];
-        stick -> data[STICK_LEFT_UPPER_LEG] = animationFirstFrame -> data[9];
-        stick -> data[STICK_LEFT_LOWER_LEG] = animationFirstFrame -> data[10];
-        stick -> data[STICK_RIGHT_UPPER_LEG] = animationFirstFrame -> data[11];
-        stick -> data[STICK_RIGHT_LOWER_LEG] = animationFirstFrame -> data[12];
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            stick -> data[STICK_ANGLES + j] = animationFirstFrame -> data[2 + j];
+        }
+        stickChanged(stickIndex);
     }
 }
 
@@ -430,9 +557,8 @@ void generateAnimation(char *filename, int32_t animationIndex) {
         list_append(newAnimation, (unitype) 0, 'd');
     }
     list_append(newAnimation, (unitype) (int32_t) round(self.framesPerSecond), 'i');
-    for (int32_t i = 0; i < 2; i++) {
-        list_append(newAnimation, (unitype) 0, 'd'); // reserved
-    }
+    list_append(newAnimation, (unitype) (double) self.rig.localAngles, 'd'); // angle space
+    list_append(newAnimation, (unitype) 0, 'd'); // reserved
     list_t *animationContents = list_init();
     list_copy(animationContents, self.currentAnimation);
     if (self.currentAnimation -> length > 0) {
@@ -461,6 +587,61 @@ void generateAnimation(char *filename, int32_t animationIndex) {
     }
 }
 
+/* convert a frame's angles (currentAnimation and animations format) between bearings and angles relative to the parent joint */
+void convertFrameAngles(list_t *frame, int8_t localAngles) {
+    double angles[STICK_MAX_JOINTS];
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        angles[j] = frame -> data[2 + j].d;
+    }
+    if (localAngles) {
+        stickAnglesToLocal(&self.rig, angles);
+    } else {
+        stickAnglesToWorld(&self.rig, angles);
+    }
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        frame -> data[2 + j].d = angles[j];
+    }
+}
+
+/* convert every frame of an animation (animations format) to an angle space */
+void convertAnimationAngles(list_t *animation, int8_t localAngles) {
+    for (int32_t i = 8; i < animation -> length; i++) {
+        convertFrameAngles(animation -> data[i].r, localAngles);
+    }
+    animation -> data[6].d = localAngles;
+}
+
+/* switch between editing bearings and angles relative to the parent joint, converts everything that is loaded */
+void setAngleSpace(int8_t localAngles) {
+    if (localAngles == self.rig.localAngles) {
+        return;
+    }
+    for (int32_t i = 0; i < self.animations -> length; i++) {
+        convertAnimationAngles(self.animations -> data[i].r, localAngles);
+    }
+    for (int32_t i = 0; i < self.currentAnimation -> length; i++) {
+        convertFrameAngles(self.currentAnimation -> data[i].r, localAngles);
+    }
+    self.frameRevision++;
+    for (int32_t i = 0; i < self.sticks -> length; i++) {
+        list_t *stick = self.sticks -> data[i].r;
+        double angles[STICK_MAX_JOINTS];
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            angles[j] = stick -> data[STICK_ANGLES + j].d;
+        }
+        if (localAngles) {
+            stickAnglesToLocal(&self.rig, angles);
+        } else {
+            stickAnglesToWorld(&self.rig, angles);
+        }
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            stick -> data[STICK_ANGLES + j].d = angles[j];
+        }
+        stickChanged(i);
+    }
+    self.rig.localAngles = localAngles;
+}
+
 /* import animation from file */
 int32_t importAnimation(char *filename) {
     uint32_t fileSize;
@@ -526,20 +707,48 @@ int32_t importAnimation(char *filename) {
         right++;
     }
     osToolsUnmapFile((uint8_t *) fileData);
+    for (int32_t i = 8; i < outputList -> length; i++) {
+        if (outputList -> type[i] != 'r' || outputList -> data[i].r -> length != 2 + self.rig.joints) {
+            printf("Error: %s was not made with this rig (%d joints)\n", filename, self.rig.joints);
+            list_free(outputList);
+            return -1;
+        }
+    }
+    /* convert to the angle space being edited in */
+    if (outputList -> data[6].d != self.rig.localAngles) {
+        convertAnimationAngles(outputList, self.rig.localAngles);
+    }
     list_append(self.animations, (unitype) outputList, 'r');
     return 0;
 }
 
+/* width of the visible part of the timeline */
+double frameViewWidth() {
+    return 320 - self.frameBarX;
+}
+
+/* how far the timeline can scroll (0 if every frame fits) */
+double frameScrollRange() {
+    double range = self.currentAnimation -> length * self.frameWidth - frameViewWidth();
+    return range > 0 ? range : 0;
+}
+
 /* show, hide, and process UI elements */
 void handleUI() {
     turtleRectangleColor(-320, 180, self.frameBarX - 1, 100, turtle.bgr, turtle.bgg, turtle.bgb, 0);
     if (self.mode) {
         self.onionSlider -> enabled = TT_ELEMENT_ENABLED;
+        self.onionAheadSlider -> enabled = TT_ELEMENT_ENABLED;
         self.frameButton -> enabled = TT_ELEMENT_ENABLED;
         self.deleteFrameButton -> enabled = TT_ELEMENT_ENABLED;
-        if (self.currentAnimation -> length >= 8) {
+        self.ikSwitch -> enabled = TT_ELEMENT_ENABLED;
+        if (frameScrollRange() > 0) {
             self.frameScrollbar -> enabled = TT_ELEMENT_ENABLED;
-            self.frameScrollbar -> barPercentage = 100 / (self.currentAnimation -> length / 7.8);
+            /* bar shows the visible part of the timeline, but stays big enough to grab */
+            self.frameScrollbar -> barPercentage = frameViewWidth() / (frameViewWidth() + frameScrollRange()) * 100;
+            if (self.frameScrollbar -> barPercentage < 5) {
+                self.frameScrollbar -> barPercentage = 5;
+            }
         } else {
             self.frameScrollbar -> enabled = TT_ELEMENT_HIDE;
         }
@@ -553,6 +762,7 @@ void handleUI() {
         if (self.deleteFrameButtonPressed) {
             if (self.currentAnimation -> length > 1) {
                 list_delete(self.currentAnimation, self.currentFrame);
+                self.frameRevision++;
                 if (self.currentFrame > 0) {
                     self.currentFrame--;
                 }
@@ -561,13 +771,15 @@ void handleUI() {
         }
     } else {
         self.onionSlider -> enabled = TT_ELEMENT_HIDE;
+        self.onionAheadSlider -> enabled = TT_ELEMENT_HIDE;
         self.frameButton -> enabled = TT_ELEMENT_HIDE;
         self.frameScrollbar -> enabled = TT_ELEMENT_HIDE;
         self.deleteFrameButton -> enabled = TT_ELEMENT_HIDE;
+        self.ikSwitch -> enabled = TT_ELEMENT_HIDE;
     }
     if (self.animations -> length >= 8) {
         self.animationScrollbar -> enabled = TT_ELEMENT_ENABLED;
-        self.frameScrollbar -> barPercentage = 100 / (self.currentAnimation -> length / 6.8);
+        self.animationScrollbar -> barPercentage = 100 / (self.animations -> length / 6.8);
     } else {
         self.animationScrollbar -> enabled = TT_ELEMENT_HIDE;
     }
@@ -575,14 +787,13 @@ void handleUI() {
         self.play = !self.play;
         if (self.play) {
             self.currentFrame = 0;
-            self.timeOfLastFrame = clock();
+            self.timeOfLastFrame = self.timeNow;
         }
     }
     if (self.play) {
         strcpy(self.playButton -> label, "Stop");
-        clock_t timeNow = clock();
-        if ((double) (timeNow - self.timeOfLastFrame) / CLOCKS_PER_SEC >= (1.0 / self.framesPerSecond)) {
-            self.timeOfLastFrame = timeNow;
+        if (timeElapsed(self.timeOfLastFrame, 1.0 / self.framesPerSecond)) {
+            self.timeOfLastFrame = self.timeNow;
             self.currentFrame++;
             if (self.currentFrame == self.currentAnimation -> length) {
                 if (self.loop) {
@@ -633,198 +844,368 @@ void renderGround() {
     turtlePenShape("circle");
 }
 
-/* render a stick */
-void renderStick(list_t *stick) {
-    double xpos = stick -> data[STICK_X].d;
-    double ypos = stick -> data[STICK_Y].d;
-    /* draw body */
-    turtlePenColorAlpha(stick -> data[STICK_RED].d, stick -> data[STICK_GREEN].d, stick -> data[STICK_BLUE].d, stick -> data[STICK_ALPHA].d);
-    turtlePenSize(stick -> data[STICK_SIZE].d * 9);
-    turtleGoto(xpos, ypos);
-    turtlePenDown();
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LOWER_BODY].d / 57.2958) * STICK_SIZE_LOWER_BODY * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LOWER_BODY].d / 57.2958) * STICK_SIZE_LOWER_BODY * stick -> data[STICK_SIZE].d);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_UPPER_BODY].d / 57.2958) * STICK_SIZE_UPPER_BODY * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_UPPER_BODY].d / 57.2958) * STICK_SIZE_UPPER_BODY * stick -> data[STICK_SIZE].d);
-    double savedX = turtle.x;
-    double savedY = turtle.y;
-    /* draw arms */
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenUp();
-    turtleGoto(savedX, savedY);
-    turtlePenDown();
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenUp();
+/* load a stick into slot of a batch */
+void batchLoadStick(stick_batch_t *batch, int32_t slot, list_t *stick) {
+    batch -> x[slot] = stick -> data[STICK_X].d;
+    batch -> y[slot] = stick -> data[STICK_Y].d;
+    batch -> size[slot] = stick -> data[STICK_SIZE].d;
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        batch -> angles[j * batch -> capacity + slot] = stick -> data[STICK_ANGLES + j].d;
+    }
+}
 
-    /* draw legs */
-    turtleGoto(xpos, ypos);
-    turtlePenDown();
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenUp();
-    turtleGoto(xpos, ypos);
-    turtlePenDown();
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenUp();
+/* load a frame (currentAnimation format) into slot of a batch at a given position and size */
+void batchLoadFrame(stick_batch_t *batch, int32_t slot, list_t *frame, double x, double y, double size) {
+    batch -> x[slot] = x;
+    batch -> y[slot] = y;
+    batch -> size[slot] = size;
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        batch -> angles[j * batch -> capacity + slot] = frame -> data[2 + j].d;
+    }
+}
 
-    /* draw head */
-    if (stick -> data[STICK_STYLE].i == STICK_STYLE_OPEN_HEAD) {
-        // turtlePenSize(STICK_SIZE_HEAD_RADIUS / 4 * stick -> data[STICK_SIZE].d);
-        // savedX += sin(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d;
-        // savedY += cos(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d;
-        // turtleGoto(savedX, savedY + STICK_SIZE_HEAD_RADIUS * stick -> data[STICK_SIZE].d);
-        // turtlePenDown();
-        // double prez = turtle.circleprez * 4 * log(2.71 + turtle.pensize);
-        // for (double i = 0; i < prez + 1; i++) {
-        //     turtleGoto(savedX + sin((360 / prez * i) / 57.2958) * STICK_SIZE_HEAD_RADIUS * stick -> data[STICK_SIZE].d, savedY + cos((360 / prez * i) / 57.2958) * STICK_SIZE_HEAD_RADIUS * stick -> data[STICK_SIZE].d);
-        // }
-        // turtlePenUp();
-        turtlePenSize(STICK_SIZE_HEAD_RADIUS * 2 * stick -> data[STICK_SIZE].d);
-        turtleGoto(savedX + sin(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d, savedY + cos(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d);
-        turtlePenDown();
-        turtlePenUp();
-        turtlePenColor(turtle.bgr, turtle.bgg, turtle.bgb);
-        turtlePenSize(turtle.pensize * 2 * 0.8);
-        turtlePenDown();
-        turtlePenUp();
-    } else if (stick -> data[STICK_STYLE].i == STICK_STYLE_CLOSED_HEAD) {
-        turtlePenSize(STICK_SIZE_HEAD_RADIUS * 2 * stick -> data[STICK_SIZE].d);
-        turtleGoto(savedX + sin(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d, savedY + cos(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d);
+/* add a stick for stickShader to draw from its angles (angles[j * stride], in the rig's angle space), colour and style come from stick */
+void renderStickInstance(list_t *stick, double alpha, double x, double y, double size, const double *angles, int32_t stride) {
+    float values[1 + STICK_MAX_JOINTS];
+    turtlePenColorAlpha(stick -> data[STICK_RED].d, stick -> data[STICK_GREEN].d, stick -> data[STICK_BLUE].d, alpha);
+    turtleInstance(x, y, size, values, stickShaderValues(values, stick -> data[STICK_STYLE].i == STICK_STYLE_OPEN_HEAD, self.rig.localAngles, angles, stride, self.rig.joints));
+}
+
+/* render a stick in slot of a batch, colour and style come from stick
+with GPU sticks it is drawn from the angles that batchLoadFrame or batchLoadStick put in the batch, otherwise from the joint positions (stickBatchForward must have been run) */
+void renderStickJoints(list_t *stick, double alpha, stick_batch_t *batch, int32_t slot) {
+    if (self.gpuSticks) {
+        renderStickInstance(stick, alpha, batch -> x[slot], batch -> y[slot], batch -> size[slot], batch -> angles + slot, batch -> capacity);
+        return;
+    }
+    double *x = batch -> jointX + slot;
+    double *y = batch -> jointY + slot;
+    int32_t capacity = batch -> capacity;
+    double size = batch -> size[slot];
+    /* lines, in depth first order so the pen only lifts when a joint branches */
+    turtlePenColorAlpha(stick -> data[STICK_RED].d, stick -> data[STICK_GREEN].d, stick -> data[STICK_BLUE].d, alpha);
+    turtlePenSize(size * 9);
+    int32_t penAt = -1; // row the pen is down at
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        if (self.rig.draw[j] != STICK_DRAW_LINE) {
+            continue;
+        }
+        int32_t start = self.rig.parent[j] + 1;
+        if (penAt != start) {
+            turtlePenUp();
+            turtleGoto(x[start * capacity], y[start * capacity]);
+            turtlePenDown();
+        }
+        turtleGoto(x[(j + 1) * capacity], y[(j + 1) * capacity]);
+        penAt = j + 1;
+    }
+    turtlePenUp();
+    /* circles (heads) */
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        if (self.rig.draw[j] != STICK_DRAW_CIRCLE) {
+            continue;
+        }
+        turtlePenColorAlpha(stick -> data[STICK_RED].d, stick -> data[STICK_GREEN].d, stick -> data[STICK_BLUE].d, alpha);
+        turtlePenSize(self.rig.radius[j] * 2 * size);
+        turtleGoto(x[(j + 1) * capacity], y[(j + 1) * capacity]);
         turtlePenDown();
         turtlePenUp();
+        if (stick -> data[STICK_STYLE].i == STICK_STYLE_OPEN_HEAD) {
+            turtlePenColor(turtle.bgr, turtle.bgg, turtle.bgb);
+            turtlePenSize(turtle.pensize * 2 * 0.8);
+            turtlePenDown();
+            turtlePenUp();
+        }
     }
 }
 
-void renderOnions() {
-    /* draw stick */
-    for (int32_t i = self.currentFrame - self.onionNumber; i < self.currentFrame; i++) {
-        if (i < 0) {
-            continue;
+/* FNV-1a hash of an array of doubles, never 0 */
+uint64_t hashDoubles(double *values, int32_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    uint8_t *bytes = (uint8_t *) values;
+    for (uint32_t i = 0; i < length * sizeof(double); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+/* write everything other than the pose that changes how onions and thumbnails look (the rig's angle space, whether sticks are drawn by the GPU, the style, the stick's colour and the background colour) to values, returns how many were written (STYLE_VALUES) */
+int32_t styleValues(double *values) {
+    int32_t length = 0;
+    values[length++] = self.rig.localAngles;
+    values[length++] = self.gpuSticks; // cached geometry is instance records in one mode and pen records in the other
+    values[length++] = self.thumbnailStick -> data[STICK_STYLE].i;
+    for (int32_t i = STICK_RED; i <= STICK_ALPHA; i++) {
+        values[length++] = self.thumbnailStick -> data[i].d;
+    }
+    values[length++] = turtle.bgr;
+    values[length++] = turtle.bgg;
+    values[length++] = turtle.bgb;
+    return length;
+}
+
+/* hash of everything that changes how a thumbnail looks other than where it is: the angles of a frame, the size, and the style */
+uint64_t thumbnailHash(list_t *frame, double size) {
+    double values[STICK_MAX_JOINTS + 1 + STYLE_VALUES];
+    int32_t length = 0;
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        values[length++] = frame -> data[2 + j].d;
+    }
+    values[length++] = size;
+    length += styleValues(values + length);
+    return hashDoubles(values, length);
+}
+
+/* copy pen records (recorded with copyPenRecords) to turtle.penPos, moved by (x, y) */
+void pastePenRecords(turtle_buffer_t *records, double x, double y) {
+    turtleBufferAppend(turtle.penPos, records, x, y);
+    /* leave the pen how drawing them would have left it */
+    for (int32_t i = records -> length - 1; i >= 0; i--) {
+        if (records -> data[i].shape < 64) {
+            turtle.pensize = records -> data[i].size;
+            turtle.penr = records -> data[i].color[0] / 255.0;
+            turtle.peng = records -> data[i].color[1] / 255.0;
+            turtle.penb = records -> data[i].color[2] / 255.0;
+            turtle.pena = records -> data[i].color[3] / 255.0;
+            break;
         }
-        if (i >= self.currentAnimation -> length) {
-            return;
+    }
+}
+
+/* copy the turtle.penPos records from start onwards to records, moved by (-x, -y) */
+void copyPenRecords(turtle_buffer_t *records, uint32_t start, double x, double y) {
+    records -> length = turtle.penPos -> length - start;
+    turtleBufferReserve(records, records -> length);
+    memcpy(records -> data, turtle.penPos -> data + start, sizeof(turtle_command_t) * records -> length);
+    for (uint32_t i = 0; i < records -> length; i++) {
+        if (records -> data[i].shape != TURTLE_BUFFER_PAYLOAD) {
+            records -> data[i].x -= x;
+            records -> data[i].y -= y;
+        }
+    }
+}
+
+/* draw the thumbnail of a frame with its stick at (x, y), copies it from the cache if this pose has been drawn before, otherwise queues it in thumbnailBatch for drawThumbnails
+   thumbnailBatch must be resized to fit every thumbnail queued before drawThumbnails is called */
+void queueThumbnail(list_t *frame, double x, double y, double size) {
+    uint64_t hash = thumbnailHash(frame, size);
+    thumbnail_t *thumbnail = NULL;
+    for (int32_t way = 0; way < THUMBNAIL_CACHE_WAYS; way++) {
+        if (self.thumbnailCache[(hash + way) & (THUMBNAIL_CACHE_SIZE - 1)].hash == hash) {
+            thumbnail = &self.thumbnailCache[(hash + way) & (THUMBNAIL_CACHE_SIZE - 1)];
+            break;
+        }
+    }
+    if (thumbnail != NULL) {
+        pastePenRecords(thumbnail -> geometry, x, y);
+        return;
+    }
+    if (self.thumbnailMisses >= self.thumbnailBatch -> capacity) {
+        return;
+    }
+    if (self.thumbnailMisses == 0) {
+        self.thumbnailMissHash = realloc(self.thumbnailMissHash, sizeof(uint64_t) * self.thumbnailBatch -> capacity);
+    }
+    self.thumbnailMissHash[self.thumbnailMisses] = hash;
+    batchLoadFrame(self.thumbnailBatch, self.thumbnailMisses, frame, x, y, size);
+    self.thumbnailMisses++;
+}
+
+/* draw the thumbnails queued by queueThumbnail that were not cached and cache them */
+void drawThumbnails() {
+    self.thumbnailBatch -> count = self.thumbnailMisses;
+    if (!self.gpuSticks) {
+        stickBatchForward(self.thumbnailBatch, &self.rig);
+    }
+    for (int32_t i = 0; i < self.thumbnailMisses; i++) {
+        int32_t start = turtle.penPos -> length;
+        renderStickJoints(self.thumbnailStick, self.thumbnailStick -> data[STICK_ALPHA].d, self.thumbnailBatch, i);
+        uint64_t hash = self.thumbnailMissHash[i];
+        thumbnail_t *thumbnail = NULL;
+        for (int32_t way = 0; way < THUMBNAIL_CACHE_WAYS; way++) {
+            uint64_t wayHash = self.thumbnailCache[(hash + way) & (THUMBNAIL_CACHE_SIZE - 1)].hash;
+            if (wayHash == 0 || wayHash == hash) { // the same pose can be queued twice in a tick
+                thumbnail = &self.thumbnailCache[(hash + way) & (THUMBNAIL_CACHE_SIZE - 1)];
+                break;
+            }
+        }
+        if (thumbnail == NULL) {
+            thumbnail = &self.thumbnailCache[(hash + self.thumbnailEvict) & (THUMBNAIL_CACHE_SIZE - 1)];
+            self.thumbnailEvict = (self.thumbnailEvict + 1) % THUMBNAIL_CACHE_WAYS;
         }
-        list_t *tempStick = list_init();
-        createStick(tempStick);
-        tempStick -> data[STICK_SIZE].d = 0.5;
-        tempStick -> data[STICK_X].d = self.currentAnimation -> data[i].r -> data[0].d;
-        tempStick -> data[STICK_Y].d = self.currentAnimation -> data[i].r -> data[1].d;
-        tempStick -> data[STICK_LOWER_BODY].d = self.currentAnimation -> data[i].r -> data[2].d;
-        tempStick -> data[STICK_UPPER_BODY].d = self.currentAnimation -> data[i].r -> data[3].d;
-        tempStick -> data[STICK_HEAD].d = self.currentAnimation -> data[i].r -> data[4].d;
-        tempStick -> data[STICK_LEFT_UPPER_ARM].d = self.currentAnimation -> data[i].r -> data[5].d;
-        tempStick -> data[STICK_LEFT_LOWER_ARM].d = self.currentAnimation -> data[i].r -> data[6].d;
-        tempStick -> data[STICK_RIGHT_UPPER_ARM].d = self.currentAnimation -> data[i].r -> data[7].d;
-        tempStick -> data[STICK_RIGHT_LOWER_ARM].d = self.currentAnimation -> data[i].r -> data[8].d;
-        tempStick -> data[STICK_LEFT_UPPER_LEG].d = self.currentAnimation -> data[i].r -> data[9].d;
-        tempStick -> data[STICK_LEFT_LOWER_LEG].d = self.currentAnimation -> data[i].r -> data[10].d;
-        tempStick -> data[STICK_RIGHT_UPPER_LEG].d = self.currentAnimation -> data[i].r -> data[11].d;
-        tempStick -> data[STICK_RIGHT_LOWER_LEG].d = self.currentAnimation -> data[i].r -> data[12].d;
+        thumbnail -> hash = hash;
+        copyPenRecords(thumbnail -> geometry, start, self.thumbnailBatch -> x[i], self.thumbnailBatch -> y[i]);
+    }
+    self.thumbnailMisses = 0;
+}
 
-        tempStick -> data[STICK_ALPHA].d = 200.0;
-        renderStick(tempStick);
-        list_free(tempStick);
+/* joint positions of a live stick, only does the work that its edits since the last call require */
+stick_batch_t *stickJoints(int32_t index) {
+    stick_cache_t *cache = self.stickCaches -> data[index].p;
+    if (cache -> moved) {
+        stickBatchResize(cache -> batch, self.rig.joints, 1);
+        batchLoadStick(cache -> batch, 0, self.sticks -> data[index].r);
+        if (cache -> anglesChanged) {
+            stickBatchBearings(cache -> batch, &self.rig);
+            stickBatchSinCos(cache -> batch, self.rig.joints);
+            cache -> anglesChanged = 0;
+        }
+        stickBatchChain(cache -> batch, &self.rig);
+        cache -> moved = 0;
+        /* move the stick's dots in the picking grid */
+        double radius = self.sticks -> data[index].r -> data[STICK_SIZE].d * 4;
+        for (int32_t j = 0; j < self.rig.joints + 1; j++) {
+            spatialGridSet(self.dotGrid, index * (STICK_MAX_JOINTS + 1) + j, cache -> batch -> jointX[j * cache -> batch -> capacity], cache -> batch -> jointY[j * cache -> batch -> capacity], radius);
+        }
     }
+    return cache -> batch;
 }
 
-/* check if mouse hovers over a dot */
-void checkMouse(list_t *stick, int32_t index, int32_t dotIndex) {
-    self.dotPositions -> data[dotIndex * 2].d = turtle.x;
-    self.dotPositions -> data[dotIndex * 2 + 1].d = turtle.y;
-    if (turtle.mouseX > turtle.x - stick -> data[STICK_SIZE].d * 4 && turtle.mouseX < turtle.x + stick -> data[STICK_SIZE].d * 4 && turtle.mouseY > turtle.y - stick -> data[STICK_SIZE].d * 4 && turtle.mouseY < turtle.y + stick -> data[STICK_SIZE].d * 4) {
-        if (self.mouseHoverDot == -1 || self.mouseHoverDistance > (turtle.mouseX - turtle.x) * (turtle.mouseX - turtle.x) + (turtle.mouseY - turtle.y) * (turtle.mouseY - turtle.y)) {
-            self.mouseHoverDot = dotIndex;
-            self.mouseHoverDistance = (turtle.mouseX - turtle.x) * (turtle.mouseX - turtle.x) + (turtle.mouseY - turtle.y) * (turtle.mouseY - turtle.y);
-            self.mouseStickIndex = index;
+/* render a stick */
+void renderStick(int32_t index) {
+    list_t *stick = self.sticks -> data[index].r;
+    if (self.gpuSticks) {
+        /* the shader places the joints, the cached joint positions are only brought up to date when dots are drawn or picked */
+        double angles[STICK_MAX_JOINTS];
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            angles[j] = stick -> data[STICK_ANGLES + j].d;
         }
+        renderStickInstance(stick, stick -> data[STICK_ALPHA].d, stick -> data[STICK_X].d, stick -> data[STICK_Y].d, stick -> data[STICK_SIZE].d, angles, 1);
+        return;
+    }
+    renderStickJoints(stick, stick -> data[STICK_ALPHA].d, stickJoints(index), 0);
+}
+
+void renderOnions() {
+    int32_t before = self.onionNumber;
+    int32_t ahead = self.onionAheadNumber;
+    double style[STYLE_VALUES];
+    uint64_t styleHash = hashDoubles(style, styleValues(style));
+    if (self.onionFrame == self.currentFrame && self.onionBefore == before && self.onionAhead == ahead && self.onionRevision == self.frameRevision && self.onionStyle == styleHash) {
+        pastePenRecords(self.onionGeometry, 0, 0);
+        return;
+    }
+    self.onionFrame = self.currentFrame;
+    self.onionBefore = before;
+    self.onionAhead = ahead;
+    self.onionRevision = self.frameRevision;
+    self.onionStyle = styleHash;
+    /* gather frames, furthest first so that nearer onions are drawn on top */
+    int32_t frames[48];
+    int32_t onions = 0;
+    for (int32_t distance = before > ahead ? before : ahead; distance > 0; distance--) {
+        if (distance <= before && self.currentFrame - distance >= 0) {
+            frames[onions++] = self.currentFrame - distance;
+        }
+        if (distance <= ahead && self.currentFrame + distance < self.currentAnimation -> length) {
+            frames[onions++] = self.currentFrame + distance;
+        }
+    }
+    int32_t start = turtle.penPos -> length;
+    if (onions > 0) {
+        stickBatchResize(self.thumbnailBatch, self.rig.joints, onions);
+        for (int32_t i = 0; i < onions; i++) {
+            list_t *frame = self.currentAnimation -> data[frames[i]].r;
+            batchLoadFrame(self.thumbnailBatch, i, frame, frame -> data[0].d, frame -> data[1].d, 0.5);
+        }
+        if (!self.gpuSticks) {
+            stickBatchForward(self.thumbnailBatch, &self.rig);
+        }
+        /* draw sticks, fading out with distance from the current frame */
+        int32_t furthest = before > ahead ? before : ahead;
+        for (int32_t i = 0; i < onions; i++) {
+            int32_t distance = abs(frames[i] - self.currentFrame);
+            renderStickJoints(self.thumbnailStick, 150.0 + 100.0 * (distance - 1) / furthest, self.thumbnailBatch, i);
+        }
+    }
+    copyPenRecords(self.onionGeometry, start, 0, 0);
+}
+
+/* find the dot under the mouse */
+void pickDot() {
+    self.mouseHoverDot = -1;
+    int32_t dot = spatialGridNearest(self.dotGrid, turtle.mouseX, turtle.mouseY, &self.mouseHoverDistance);
+    if (dot != -1) {
+        self.mouseStickIndex = dot / (STICK_MAX_JOINTS + 1);
+        self.mouseHoverDot = dot % (STICK_MAX_JOINTS + 1);
     }
 }
 
+/* position of a dot (row 0 is the stick's position, row j + 1 is the end of joint j) */
+void dotPosition(int32_t stickIndex, int32_t dot, double *x, double *y) {
+    stick_batch_t *batch = stickJoints(stickIndex);
+    *x = batch -> jointX[dot * batch -> capacity];
+    *y = batch -> jointY[dot * batch -> capacity];
+}
+
 /* render dots on a stick */
 void renderDots(int32_t index) {
-    self.mouseHoverDot = -1;
     list_t *stick = self.sticks -> data[index].r;
-    double xpos = stick -> data[STICK_X].d;
-    double ypos = stick -> data[STICK_Y].d;
-    /* draw body */
-    turtlePenColor(225, 70, 0);
+    stick_batch_t *batch = stickJoints(index);
     turtlePenSize(stick -> data[STICK_SIZE].d * 6);
-    turtleGoto(xpos, ypos);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, 0);
-    turtlePenColor(0, 0, 0);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LOWER_BODY].d / 57.2958) * STICK_SIZE_LOWER_BODY * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LOWER_BODY].d / 57.2958) * STICK_SIZE_LOWER_BODY * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_LOWER_BODY);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_UPPER_BODY].d / 57.2958) * STICK_SIZE_UPPER_BODY * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_UPPER_BODY].d / 57.2958) * STICK_SIZE_UPPER_BODY * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_UPPER_BODY);
-    double savedX = turtle.x;
-    double savedY = turtle.y;
-    /* draw arms */
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_LEFT_UPPER_ARM);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_LEFT_LOWER_ARM);
-    turtleGoto(savedX, savedY);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_UPPER_ARM].d / 57.2958) * STICK_SIZE_UPPER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_RIGHT_UPPER_ARM);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_LOWER_ARM].d / 57.2958) * STICK_SIZE_LOWER_ARM * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_RIGHT_LOWER_ARM);
-
-    /* draw legs */
-    turtleGoto(xpos, ypos);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_LEFT_UPPER_LEG);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_LEFT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_LEFT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_LEFT_LOWER_LEG);
-    turtleGoto(xpos, ypos);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_UPPER_LEG].d / 57.2958) * STICK_SIZE_UPPER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_RIGHT_UPPER_LEG);
-    turtleGoto(turtle.x + sin(stick -> data[STICK_RIGHT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d, turtle.y + cos(stick -> data[STICK_RIGHT_LOWER_LEG].d / 57.2958) * STICK_SIZE_LOWER_LEG * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_RIGHT_LOWER_LEG);
-
-    /* draw head */
-    turtleGoto(savedX + sin(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d, savedY + cos(stick -> data[STICK_HEAD].d / 57.2958) * STICK_SIZE_HEAD * stick -> data[STICK_SIZE].d);
-    turtlePenDown();
-    turtlePenUp();
-    checkMouse(stick, index, STICK_HEAD);
+    for (int32_t j = 0; j < self.rig.joints + 1; j++) {
+        if (j == 0) {
+            turtlePenColor(225, 70, 0);
+        } else if (self.pinned[j - 1] && index == self.pinStickIndex) {
+            turtlePenColor(0, 120, 225);
+        } else {
+            turtlePenColor(0, 0, 0);
+        }
+        turtleGoto(batch -> jointX[j * batch -> capacity], batch -> jointY[j * batch -> capacity]);
+        turtlePenDown();
+        turtlePenUp();
+    }
 }
 
 /* render frame topbar */
 void renderFrames() {
     self.mouseHoverFrame = -1;
-    for (int32_t i = 0; i < self.currentAnimation -> length; i++) {
-        double frameXLeft = self.frameBarX + i * 66 - self.frameScroll * (self.currentAnimation -> length - 7.5) * 0.66;
+    /* scroll wheel over the timeline scrolls, ctrl + scroll wheel zooms around the mouse */
+    if (turtle.mouseY <= self.frameBarY && turtle.mouseY >= self.frameBarY - 45 && turtle.mouseX >= self.frameBarX) {
+        double wheel = self.mouseWheel;
+        if (wheel != 0) {
+            double offset = self.frameScroll / 100 * frameScrollRange();
+            double mouseFrame = (offset + turtle.mouseX - self.frameBarX) / self.frameWidth;
+            if (self.keys[4]) {
+                self.frameWidth *= pow(1.25, wheel);
+                if (self.frameWidth < 4) {
+                    self.frameWidth = 4;
+                }
+                if (self.frameWidth > 132) {
+                    self.frameWidth = 132;
+                }
+                offset = mouseFrame * self.frameWidth - (turtle.mouseX - self.frameBarX);
+            } else {
+                offset -= wheel * 3 * self.frameWidth;
+            }
+            self.frameScroll = frameScrollRange() > 0 ? offset / frameScrollRange() * 100 : 0;
+            if (self.frameScroll < 0) {
+                self.frameScroll = 0;
+            }
+            if (self.frameScroll > 100) {
+                self.frameScroll = 100;
+            }
+        }
+    }
+    /* only frames in view are touched */
+    double offset = self.frameScroll / 100 * frameScrollRange();
+    int32_t first = floor(offset / self.frameWidth);
+    int32_t last = floor((offset + frameViewWidth()) / self.frameWidth);
+    if (first < 0) {
+        first = 0;
+    }
+    if (last > self.currentAnimation -> length - 1) {
+        last = self.currentAnimation -> length - 1;
+    }
+    int8_t drawSticks = self.frameWidth >= 24; // too small to see when zoomed out
+    int8_t drawNumbers = self.frameWidth >= 16;
+    stickBatchResize(self.thumbnailBatch, self.rig.joints, last - first + 1 > 0 ? last - first + 1 : 0);
+    for (int32_t i = first; i <= last; i++) {
+        double frameXLeft = self.frameBarX + i * self.frameWidth - offset;
         double frameYUp = self.frameBarY;
-        double frameXRight = frameXLeft + 64; 
+        double frameXRight = frameXLeft + self.frameWidth - 2;
         double frameYDown = frameYUp - 36;
-        if (frameXRight < self.frameBarX) {
-            continue;
-        }
-        if (frameXLeft > 320) {
-            return;
-        }
         /* detect mouse */
         if (turtle.mouseX >= frameXLeft && turtle.mouseX <= frameXRight && turtle.mouseY >= frameYDown && turtle.mouseY <= frameYUp) {
             self.mouseHoverFrame = i;
@@ -847,35 +1228,106 @@ void renderFrames() {
         turtleGoto(frameXLeft, frameYDown);
         turtleGoto(frameXLeft, frameYUp);
         turtlePenUp();
-        turtleTextWriteStringf(frameXLeft + 2, frameYUp - 5, 5, 0, "%d", i + 1);
-        /* draw stick */
-        list_t *tempStick = list_init();
-        createStick(tempStick);
-        tempStick -> data[STICK_SIZE].d = 0.05;
-        tempStick -> data[STICK_X].d = frameXLeft + ((self.currentAnimation -> data[i].r -> data[0].d + 330) / 660) * (frameXRight - frameXLeft);
-        tempStick -> data[STICK_Y].d = frameYDown + ((self.currentAnimation -> data[i].r -> data[1].d + 190) / 380) * (frameYUp - frameYDown);
-        tempStick -> data[STICK_LOWER_BODY].d = self.currentAnimation -> data[i].r -> data[2].d;
-        tempStick -> data[STICK_UPPER_BODY].d = self.currentAnimation -> data[i].r -> data[3].d;
-        tempStick -> data[STICK_HEAD].d = self.currentAnimation -> data[i].r -> data[4].d;
-        tempStick -> data[STICK_LEFT_UPPER_ARM].d = self.currentAnimation -> data[i].r -> data[5].d;
-        tempStick -> data[STICK_LEFT_LOWER_ARM].d = self.currentAnimation -> data[i].r -> data[6].d;
-        tempStick -> data[STICK_RIGHT_UPPER_ARM].d = self.currentAnimation -> data[i].r -> data[7].d;
-        tempStick -> data[STICK_RIGHT_LOWER_ARM].d = self.currentAnimation -> data[i].r -> data[8].d;
-        tempStick -> data[STICK_LEFT_UPPER_LEG].d = self.currentAnimation -> data[i].r -> data[9].d;
-        tempStick -> data[STICK_LEFT_LOWER_LEG].d = self.currentAnimation -> data[i].r -> data[10].d;
-        tempStick -> data[STICK_RIGHT_UPPER_LEG].d = self.currentAnimation -> data[i].r -> data[11].d;
-        tempStick -> data[STICK_RIGHT_LOWER_LEG].d = self.currentAnimation -> data[i].r -> data[12].d;
-        renderStick(tempStick);
-        list_free(tempStick);
+        if (drawNumbers) {
+            turtleTextWriteStringf(frameXLeft + 2, frameYUp - 5, 5, 0, "%d", i + 1);
+        }
+        /* queue stick */
+        if (drawSticks) {
+            list_t *frame = self.currentAnimation -> data[i].r;
+            queueThumbnail(frame, frameXLeft + ((frame -> data[0].d + 330) / 660) * (frameXRight - frameXLeft), frameYDown + ((frame -> data[1].d + 190) / 380) * (frameYUp - frameYDown), 0.05 * self.frameWidth / 66);
+        }
+    }
+    drawThumbnails();
+}
+
+/* top of an animation's box in the sidebar */
+double animationTop(int32_t animationIndex) {
+    return self.animationBarY - animationIndex * 38 + self.animationScroll * (self.animations -> length - 7.5) * 0.38;
+}
+
+/* move a preview to the next frame of its animation */
+void previewAdvance(preview_t *preview, list_t *animation) {
+    preview -> timeOfLastFrame = self.timeNow;
+    preview -> frame++;
+    if (preview -> frame >= animation -> length - 8) {
+        preview -> frame = 0;
+        preview -> x = animation -> data[3].d;
+        preview -> y = animation -> data[4].d;
+    } else {
+        preview -> x += animation -> data[8 + preview -> frame].r -> data[0].d;
+        preview -> y += animation -> data[8 + preview -> frame].r -> data[1].d;
+    }
+}
+
+/* frame of an animation to show in the sidebar, a hovered animation plays at its own rate (the rest are advanced by previewCycle) */
+preview_t *previewFrame(int32_t animationIndex, int8_t hovered) {
+    if (animationIndex >= self.previewCapacity) {
+        int32_t capacity = self.previewCapacity > 0 ? self.previewCapacity : 8;
+        while (capacity <= animationIndex) {
+            capacity *= 2;
+        }
+        self.previews = realloc(self.previews, sizeof(preview_t) * capacity);
+        for (int32_t i = self.previewCapacity; i < capacity; i++) {
+            self.previews[i].frame = -1;
+        }
+        self.previewCapacity = capacity;
+    }
+    list_t *animation = self.animations -> data[animationIndex].r;
+    preview_t *preview = &self.previews[animationIndex];
+    if (preview -> frame < 0 || preview -> frame >= animation -> length - 8 || (!hovered && !self.previewAnimations)) {
+        preview -> frame = 0;
+        preview -> x = animation -> data[3].d;
+        preview -> y = animation -> data[4].d;
+        preview -> timeOfLastFrame = self.timeNow;
+    }
+    if (hovered && timeElapsed(preview -> timeOfLastFrame, 1.0 / animation -> data[5].i)) {
+        previewAdvance(preview, animation);
+    }
+    return preview;
+}
+
+/* advance the visible previews that are due at PREVIEW_FRAMES_PER_SECOND, at most PREVIEW_UPDATES_PER_TICK of them per tick
+starts where the last tick stopped so that previews further down the sidebar are not starved by the ones above them */
+void previewCycle() {
+    if (!self.previewAnimations) {
+        return;
+    }
+    int32_t first = 0;
+    while (first < self.animations -> length && animationTop(first) - 36 > self.animationBarY) {
+        first++;
+    }
+    int32_t last = first;
+    while (last < self.animations -> length && animationTop(last) >= -180) {
+        last++;
+    }
+    int32_t count = last - first;
+    if (count == 0) {
+        return;
+    }
+    int32_t start = self.previewCursor >= first && self.previewCursor < last ? self.previewCursor : first;
+    int32_t updates = 0;
+    for (int32_t k = 0; k < count && updates < PREVIEW_UPDATES_PER_TICK; k++) {
+        int32_t i = first + (start - first + k) % count;
+        if (i == self.mouseHoverAnimation) {
+            continue;
+        }
+        preview_t *preview = previewFrame(i, 0);
+        if (timeElapsed(preview -> timeOfLastFrame, 1.0 / PREVIEW_FRAMES_PER_SECOND)) {
+            previewAdvance(preview, self.animations -> data[i].r);
+            updates++;
+            self.previewCursor = i + 1;
+        }
     }
 }
 
 /* render animation sidebar */
 void renderAnimations() {
+    previewCycle(); // the animation hovered last tick is skipped, it plays at its own rate below
     self.mouseHoverAnimation = -1;
+    stickBatchResize(self.thumbnailBatch, self.rig.joints, self.animations -> length);
     for (int32_t i = 0; i < self.animations -> length; i++) {
         double animationXLeft = self.animationBarX;
-        double animationYUp = self.animationBarY - i * 38 + self.animationScroll * (self.animations -> length - 7.5) * 0.38;
+        double animationYUp = animationTop(i);
         double animationXRight = animationXLeft + 64;
         double animationYDown = animationYUp - 36;
         if (animationYDown > self.animationBarY) {
@@ -907,29 +1359,65 @@ void renderAnimations() {
         turtleGoto(animationXLeft, animationYUp);
         turtlePenUp();
         turtleTextWriteStringf(animationXLeft + 2, animationYUp - 5, 5, 0, "%s", self.animations -> data[i].r -> data[1].s);
-        /* draw thumbnail */
-        list_t *tempStick = list_init();
-        createStick(tempStick);
-        tempStick -> data[STICK_SIZE].d = 0.05;
-        tempStick -> data[STICK_X].d = animationXLeft + ((self.animations -> data[i].r -> data[3].d + 330) / 660) * (animationXRight - animationXLeft);
-        tempStick -> data[STICK_Y].d = animationYDown + ((self.animations -> data[i].r -> data[4].d + 190) / 380) * (animationYUp - animationYDown);
-        tempStick -> data[STICK_LOWER_BODY].d = self.animations -> data[i].r -> data[8].r -> data[2].d;
-        tempStick -> data[STICK_UPPER_BODY].d = self.animations -> data[i].r -> data[8].r -> data[3].d;
-        tempStick -> data[STICK_HEAD].d = self.animations -> data[i].r -> data[8].r -> data[4].d;
-        tempStick -> data[STICK_LEFT_UPPER_ARM].d = self.animations -> data[i].r -> data[8].r -> data[5].d;
-        tempStick -> data[STICK_LEFT_LOWER_ARM].d = self.animations -> data[i].r -> data[8].r -> data[6].d;
-        tempStick -> data[STICK_RIGHT_UPPER_ARM].d = self.animations -> data[i].r -> data[8].r -> data[7].d;
-        tempStick -> data[STICK_RIGHT_LOWER_ARM].d = self.animations -> data[i].r -> data[8].r -> data[8].d;
-        tempStick -> data[STICK_LEFT_UPPER_LEG].d = self.animations -> data[i].r -> data[8].r -> data[9].d;
-        tempStick -> data[STICK_LEFT_LOWER_LEG].d = self.animations -> data[i].r -> data[8].r -> data[10].d;
-        tempStick -> data[STICK_RIGHT_UPPER_LEG].d = self.animations -> data[i].r -> data[8].r -> data[11].d;
-        tempStick -> data[STICK_RIGHT_LOWER_LEG].d = self.animations -> data[i].r -> data[8].r -> data[12].d;
-        renderStick(tempStick);
-        list_free(tempStick);
+        /* queue thumbnail */
+        list_t *animation = self.animations -> data[i].r;
+        preview_t *preview = previewFrame(i, self.mouseHoverAnimation == i);
+        queueThumbnail(animation -> data[8 + preview -> frame].r, animationXLeft + ((preview -> x + 330) / 660) * (animationXRight - animationXLeft), animationYDown + ((preview -> y + 190) / 380) * (animationYUp - animationYDown), 0.05);
     }
+    drawThumbnails();
     turtleRectangleColor(self.animationBarX - 10, self.animationBarY + 1, 320, 180, turtle.bgr, turtle.bgg, turtle.bgb, 0);
 }
 
+/* move the end of a joint to (x, y) by bending the joints above it */
+void stickReach(int32_t stickIndex, int32_t joint, double x, double y) {
+    list_t *stick = self.sticks -> data[stickIndex].r;
+    double pose[STICK_MAX_JOINTS + 2];
+    getStickPose(stickIndex, pose);
+    stickSolveIK(&self.rig, pose[0], pose[1], stick -> data[STICK_SIZE].d, pose + 2, joint, x, y);
+    setStickPose(stickIndex, pose);
+}
+
+/* put pinned hands and feet back where they were pinned, unless the joint being dragged (-1 for the stick's position) is one of the joints holding them */
+void stickHoldPins(int32_t stickIndex, int32_t draggedJoint) {
+    if (stickIndex != self.pinStickIndex) {
+        return;
+    }
+    list_t *stick = self.sticks -> data[stickIndex].r;
+    double pose[STICK_MAX_JOINTS + 2];
+    getStickPose(stickIndex, pose);
+    int8_t held = 0;
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        if (self.pinned[j] && (draggedJoint == -1 || !stickJointAncestor(&self.rig, draggedJoint, j))) {
+            stickSolveTwoBone(&self.rig, pose[0], pose[1], stick -> data[STICK_SIZE].d, pose + 2, j, self.pinPositions[j * 2], self.pinPositions[j * 2 + 1]);
+            held = 1;
+        }
+    }
+    if (held) {
+        setStickPose(stickIndex, pose);
+    }
+}
+
+/* pin or unpin the hovered hand or foot (only joints at the end of a chain of two can be pinned) */
+void togglePin() {
+    if (self.mouseHoverDot < 1) {
+        return;
+    }
+    int32_t joint = self.mouseHoverDot - 1;
+    if (self.rig.subtreeEnd[joint] != joint + 1 || stickChainLength(&self.rig, joint) < 2) {
+        return;
+    }
+    if (self.pinned[joint]) {
+        self.pinned[joint] = 0;
+        return;
+    }
+    if (self.pinStickIndex != self.mouseStickIndex) {
+        memset(self.pinned, 0, sizeof(self.pinned));
+        self.pinStickIndex = self.mouseStickIndex;
+    }
+    self.pinned[joint] = 1;
+    dotPosition(self.mouseStickIndex, self.mouseHoverDot, &self.pinPositions[joint * 2], &self.pinPositions[joint * 2 + 1]);
+}
+
 void mouseTick() {
     if (turtleMouseDown()) {
         if (self.keys[0] == 0) {
@@ -943,8 +1431,9 @@ void mouseTick() {
                     self.positionAnchorX = self.sticks -> data[self.mouseStickIndex].r -> data[0].d;
                     self.positionAnchorY = self.sticks -> data[self.mouseStickIndex].r -> data[1].d;
                 } else {
-                    self.positionAnchorX = self.dotPositions -> data[self.limbParents -> data[self.mouseDraggingDot].i * 2].d;
-                    self.positionAnchorY = self.dotPositions -> data[self.limbParents -> data[self.mouseDraggingDot].i * 2 + 1].d;
+                    /* rotate around the start of the joint */
+                    int32_t start = self.rig.parent[self.mouseDraggingDot - 1] + 1;
+                    dotPosition(self.mouseStickIndex, start, &self.positionAnchorX, &self.positionAnchorY);
                 }
             }
             if (self.mode && self.mouseHoverFrame != -1) {
@@ -977,14 +1466,21 @@ void mouseTick() {
                         self.sticks -> data[self.mouseStickIndex].r -> data[0].d = round(((turtle.mouseX - self.mouseAnchorX) + self.positionAnchorX - self.gridBounds[0]) / self.gridSize) * self.gridSize + self.gridBounds[0];
                         self.sticks -> data[self.mouseStickIndex].r -> data[1].d = round(((turtle.mouseY - self.mouseAnchorY) + self.positionAnchorY - self.gridBounds[1]) / self.gridSize) * self.gridSize + self.gridBounds[1];
                     }
+                    stickMoved(self.mouseStickIndex);
+                    stickHoldPins(self.mouseStickIndex, -1);
+                } else if (self.ik) {
+                    /* move the dot to the mouse */
+                    stickReach(self.mouseStickIndex, self.mouseDraggingDot - 1, turtle.mouseX, turtle.mouseY);
+                    stickHoldPins(self.mouseStickIndex, self.mouseDraggingDot - 1);
                 } else {
-                    /* change angle */
-                    double lastAngle = self.sticks -> data[self.mouseStickIndex].r -> data[self.mouseDraggingDot].d;
-                    self.sticks -> data[self.mouseStickIndex].r -> data[self.mouseDraggingDot].d = 57.2958 * atan2(turtle.mouseX - self.positionAnchorX, turtle.mouseY - self.positionAnchorY);
-                    double angleChange = self.sticks -> data[self.mouseStickIndex].r -> data[self.mouseDraggingDot].d - lastAngle;
-                    for (int32_t i = 0; i < self.limbChildren -> data[self.mouseDraggingDot].r -> length; i++) {
-                        self.sticks -> data[self.mouseStickIndex].r -> data[self.limbChildren -> data[self.mouseDraggingDot].r -> data[i].i].d += angleChange;
-                    }
+                    /* change angle, everything attached to the joint turns with it */
+                    int32_t joint = self.mouseDraggingDot - 1;
+                    double pose[STICK_MAX_JOINTS + 2];
+                    getStickPose(self.mouseStickIndex, pose);
+                    double bearing = 57.2958 * atan2(turtle.mouseX - self.positionAnchorX, turtle.mouseY - self.positionAnchorY);
+                    stickRotateJoint(&self.rig, pose + 2, joint, bearing - stickJointBearing(&self.rig, pose + 2, joint));
+                    setStickPose(self.mouseStickIndex, pose);
+                    stickHoldPins(self.mouseStickIndex, joint);
                 }
             }
         }
@@ -998,6 +1494,16 @@ void mouseTick() {
             }
         }
     }
+    if (turtleMouseRight()) {
+        if (self.keys[1] == 0) {
+            self.keys[1] = 1;
+            if (self.mode && self.mouseHoverDot != -1) {
+                togglePin();
+            }
+        }
+    } else {
+        self.keys[1] = 0;
+    }
     if (turtleKeyPressed(GLFW_KEY_LEFT_CONTROL)) {
         if (self.keys[4] == 0) {
             self.keys[4] = 1;
@@ -1045,13 +1551,12 @@ void mouseTick() {
             self.advancedPlay = 1;
             /* setup animation */
             self.advancedFrame = 0;
-            self.timeOfLastAdvancedFrame = clock();
+            self.timeOfLastAdvancedFrame = self.timeNow;
             loadFirstFrame(0, 0);
         } else {
             /* key held */
-            clock_t timeNow = clock();
-            if ((double) (timeNow - self.timeOfLastAdvancedFrame) / CLOCKS_PER_SEC >= (1.0 / self.animations -> data[0].r -> data[5].i)) {
-                self.timeOfLastAdvancedFrame = timeNow;
+            if (timeElapsed(self.timeOfLastAdvancedFrame, 1.0 / self.animations -> data[0].r -> data[5].i)) {
+                self.timeOfLastAdvancedFrame = self.timeNow;
                 self.advancedFrame++;
                 if (self.advancedFrame == self.currentAnimation -> length) {
                     self.advancedFrame = 0;
@@ -1067,6 +1572,209 @@ void mouseTick() {
     }
 }
 
+/* copy stick position and angles to a pose (same format as a currentAnimation frame) */
+void getStickPose(int32_t stickIndex, double *pose) {
+    list_t *stick = self.sticks -> data[stickIndex].r;
+    pose[0] = stick -> data[STICK_X].d;
+    pose[1] = stick -> data[STICK_Y].d;
+    for (int32_t i = 0; i < self.rig.joints; i++) {
+        pose[2 + i] = stick -> data[STICK_ANGLES + i].d;
+    }
+}
+
+/* put stick in pose */
+void setStickPose(int32_t stickIndex, double *pose) {
+    list_t *stick = self.sticks -> data[stickIndex].r;
+    stick -> data[STICK_X].d = pose[0];
+    stick -> data[STICK_Y].d = pose[1];
+    for (int32_t i = 0; i < self.rig.joints; i++) {
+        stick -> data[STICK_ANGLES + i].d = pose[2 + i];
+    }
+    stickChanged(stickIndex);
+}
+
+/* signed difference between two angles (degrees), along the shortest arc */
+double angleDifference(double from, double to) {
+    double difference = fmod(to - from, 360);
+    if (difference > 180) {
+        difference -= 360;
+    }
+    if (difference < -180) {
+        difference += 360;
+    }
+    return difference;
+}
+
+/* returns 1 if the animation exists and has frames */
+int8_t clipPlayable(int32_t animationIndex) {
+    return animationIndex >= 0 && animationIndex < self.animations -> length && self.animations -> data[animationIndex].r -> length > 8;
+}
+
+/* start an animation from its first frame */
+void clipStart(clip_state_t *clip, int32_t animationIndex, double x, double y, double weight) {
+    clip -> animationIndex = animationIndex;
+    clip -> frame = 0;
+    clip -> x = x;
+    clip -> y = y;
+    clip -> weight = weight;
+    clip -> timeOfLastFrame = self.timeNow;
+}
+
+/* move a clip to its next frame once the animation's frame time has passed (loops) */
+void clipAdvance(clip_state_t *clip) {
+    list_t *animation = self.animations -> data[clip -> animationIndex].r;
+    if (timeElapsed(clip -> timeOfLastFrame, 1.0 / animation -> data[5].i)) {
+        clip -> timeOfLastFrame = self.timeNow;
+        clip -> frame++;
+        if (clip -> frame >= animation -> length - 8) {
+            clip -> frame = 0;
+        }
+        clip -> x += animation -> data[8 + clip -> frame].r -> data[0].d;
+        clip -> y += animation -> data[8 + clip -> frame].r -> data[1].d;
+    }
+}
+
+/* get the pose of a clip's current frame */
+void clipPose(clip_state_t *clip, double *pose) {
+    list_t *frame = self.animations -> data[clip -> animationIndex].r -> data[8 + clip -> frame].r;
+    pose[0] = clip -> x;
+    pose[1] = clip -> y;
+    for (int32_t i = 2; i < 2 + self.rig.joints; i++) {
+        pose[i] = frame -> data[i].d;
+    }
+}
+
+/* cross-fade from the stick's current pose into an animation */
+void clipTrigger(int32_t animationIndex) {
+    getStickPose(0, self.clipFromPose);
+    clipStart(&self.clipBase, animationIndex, self.clipFromPose[0], self.clipFromPose[1], 1);
+    self.clipBlendStart = self.clipBase.timeOfLastFrame;
+}
+
+/* add an animation as an additive layer, or remove it if it is already a layer */
+void clipToggleLayer(int32_t animationIndex) {
+    for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+        if (self.clipLayers[i].animationIndex == animationIndex) {
+            self.clipLayers[i].animationIndex = -1;
+            return;
+        }
+    }
+    for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+        if (self.clipLayers[i].animationIndex == -1) {
+            clipStart(&self.clipLayers[i], animationIndex, 0, 0, 1);
+            return;
+        }
+    }
+}
+
+/* returns 1 if any additive layer is playing */
+int8_t clipLayering() {
+    for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+        if (self.clipLayers[i].animationIndex != -1) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* play key bound animations - work per tick depends only on CLIP_BINDINGS and CLIP_LAYERS, not the number of animations
+keys 1 - 9 cross-fade into their bound animation, shift + key toggles it as an additive layer (over the stick's own pose if nothing is playing), ctrl + key binds the selected animation, 0 stops
+does nothing while a dot is dragged or the timeline is playing, so that it never overwrites them */
+void clipTick() {
+    if (self.mouseDraggingDot != -1 || self.play || self.advancedPlay) {
+        return;
+    }
+    for (int32_t i = 0; i < CLIP_BINDINGS; i++) {
+        if (turtleKeyPressed(GLFW_KEY_1 + i)) {
+            if (self.clipKeys[i] == 0) {
+                self.clipKeys[i] = 1;
+                if (self.keys[4]) {
+                    self.clipBindings[i] = self.animationSaveIndex;
+                    printf("Bound %d to %s\n", i + 1, self.animations -> data[self.animationSaveIndex].r -> data[1].s);
+                } else if (clipPlayable(self.clipBindings[i])) {
+                    if (turtleKeyPressed(GLFW_KEY_LEFT_SHIFT)) {
+                        clipToggleLayer(self.clipBindings[i]);
+                    } else {
+                        clipTrigger(self.clipBindings[i]);
+                    }
+                }
+            }
+        } else {
+            self.clipKeys[i] = 0;
+        }
+    }
+    if (turtleKeyPressed(GLFW_KEY_0)) {
+        self.clipBase.animationIndex = -1;
+        for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+            self.clipLayers[i].animationIndex = -1;
+        }
+    }
+    double pose[STICK_MAX_JOINTS + 2];
+    int8_t offsetApplied = 0; // the stick still has last tick's layers added to its own pose
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        if (self.clipLayerOffset[j] != 0) {
+            offsetApplied = 1;
+        }
+    }
+    if (clipPlayable(self.clipBase.animationIndex)) {
+        clipAdvance(&self.clipBase);
+        clipPose(&self.clipBase, pose);
+        /* cross-fade */
+        double blend = (self.timeNow - self.clipBlendStart) * 1000 / self.clipBlendMilliseconds;
+        if (blend < 1) {
+            pose[0] = self.clipFromPose[0] + (pose[0] - self.clipFromPose[0]) * blend;
+            pose[1] = self.clipFromPose[1] + (pose[1] - self.clipFromPose[1]) * blend;
+            for (int32_t i = 2; i < 2 + self.rig.joints; i++) {
+                pose[i] = self.clipFromPose[i] + angleDifference(self.clipFromPose[i], pose[i]) * blend;
+            }
+        }
+    } else {
+        self.clipBase.animationIndex = -1;
+        if (!clipLayering() && !offsetApplied) {
+            return;
+        }
+        /* layers go over the stick's own pose, without what they added last tick (unless something else has moved the stick since, then its new pose is its own) */
+        getStickPose(0, pose);
+        if (memcmp(pose, self.clipLayerPose, sizeof(double) * (2 + self.rig.joints)) == 0) {
+            for (int32_t j = 0; j < self.rig.joints; j++) {
+                pose[2 + j] -= self.clipLayerOffset[j];
+            }
+        }
+    }
+    /* additive layers add their change from their first frame */
+    double offset[STICK_MAX_JOINTS];
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        offset[j] = 0;
+    }
+    for (int32_t i = 0; i < CLIP_LAYERS; i++) {
+        clip_state_t *layer = &self.clipLayers[i];
+        if (layer -> animationIndex == -1) {
+            continue;
+        }
+        if (!clipPlayable(layer -> animationIndex)) {
+            layer -> animationIndex = -1;
+            continue;
+        }
+        clipAdvance(layer);
+        list_t *firstFrame = self.animations -> data[layer -> animationIndex].r -> data[8].r;
+        list_t *frame = self.animations -> data[layer -> animationIndex].r -> data[8 + layer -> frame].r;
+        for (int32_t j = 0; j < self.rig.joints; j++) {
+            offset[j] += layer -> weight * angleDifference(firstFrame -> data[2 + j].d, frame -> data[2 + j].d);
+        }
+    }
+    for (int32_t j = 0; j < self.rig.joints; j++) {
+        pose[2 + j] += offset[j];
+        self.clipLayerOffset[j] = self.clipBase.animationIndex == -1 ? offset[j] : 0;
+    }
+    setStickPose(0, pose);
+    memcpy(self.clipLayerPose, pose, sizeof(double) * (2 + self.rig.joints));
+}
+
+/* returns 1 if anything on screen can change without input */
+int8_t isAnimating() {
+    return self.play || self.advancedPlay || self.clipBase.animationIndex != -1 || clipLayering() || self.mouseDraggingDot != -1 || self.mouseHoverAnimation != -1 || self.previewAnimations || turtle.close;
+}
+
 void parseRibbonOutput() {
     if (ribbonRender.output[0] == 1) {
         ribbonRender.output[0] = 0;
@@ -1134,6 +1842,10 @@ void parseRibbonOutput() {
                 osToolsClipboardGetText();
                 printf("Pasted \"%s\" from clipboard!\n", osToolsClipboard.text);
             }
+            if (ribbonRender.output[2] == 6) { // Local Angles
+                setAngleSpace(!self.rig.localAngles);
+                printf("Angles %s\n", self.rig.localAngles ? "relative to parent joints" : "are bearings");
+            }
         }
         if (ribbonRender.output[1] == 2) { // View
             if (ribbonRender.output[2] == 1) { // Change theme
@@ -1154,6 +1866,22 @@ void parseRibbonOutput() {
             if (ribbonRender.output[2] == 2) { // GLFW
                 printf("GLFW settings\n");
             } 
+            if (ribbonRender.output[2] == 3) { // Idle Mode
+                self.idleMode = !self.idleMode;
+                printf("Idle mode %s\n", self.idleMode ? "on" : "off");
+            }
+            if (ribbonRender.output[2] == 4) { // Sidebar Previews
+                self.previewAnimations = !self.previewAnimations;
+                printf("Sidebar previews %s\n", self.previewAnimations ? "on" : "off");
+            }
+            if (ribbonRender.output[2] == 5) { // GPU Sticks
+                if (self.gpuSticksSupported) {
+                    self.gpuSticks = !self.gpuSticks;
+                    printf("GPU sticks %s\n", self.gpuSticks ? "on" : "off");
+                } else {
+                    printf("GPU sticks need OpenGL 3.1\n");
+                }
+            }
         }
     }
 }
@@ -1171,7 +1899,339 @@ void parsePopupOutput(GLFWwindow *window) {
     }
 }
 
+/* turtle.vertexSink that keeps the triangles of an export frame for a worker */
+void exportSink(void *data, turtle_vertex_t *vertices, uint32_t vertexCount, uint32_t *indices, uint32_t indexCount) {
+    export_frame_t *frame = data;
+    if (frame -> vertexCount + vertexCount > frame -> vertexCapacity) {
+        frame -> vertexCapacity = (frame -> vertexCount + vertexCount) * 2;
+        frame -> vertices = realloc(frame -> vertices, sizeof(turtle_vertex_t) * frame -> vertexCapacity);
+    }
+    if (frame -> indexCount + indexCount > frame -> indexCapacity) {
+        frame -> indexCapacity = (frame -> indexCount + indexCount) * 2;
+        frame -> indices = realloc(frame -> indices, sizeof(uint32_t) * frame -> indexCapacity);
+    }
+    memcpy(frame -> vertices + frame -> vertexCount, vertices, sizeof(turtle_vertex_t) * vertexCount);
+    for (uint32_t i = 0; i < indexCount; i++) {
+        frame -> indices[frame -> indexCount + i] = indices[i] + frame -> vertexCount;
+    }
+    frame -> vertexCount += vertexCount;
+    frame -> indexCount += indexCount;
+}
+
+/* draw a frame of the current animation with the default stick's colour, size and style */
+void renderExportFrame(stick_batch_t *batch, int32_t frameIndex) {
+    list_t *stick = self.sticks -> data[0].r;
+    list_t *frame = self.currentAnimation -> data[frameIndex].r;
+    turtleClear();
+    batchLoadFrame(batch, 0, frame, frame -> data[0].d, frame -> data[1].d, stick -> data[STICK_SIZE].d);
+    stickBatchForward(batch, &self.rig);
+    renderStickJoints(stick, stick -> data[STICK_ALPHA].d, batch, 0);
+}
+
+/* the colours that an exported frame can have: the background, then the default stick's colour over it once, twice... (translucent strokes overlap), blended the way turtleRaster does. Returns how many (at most 256) */
+int32_t exportPalette(uint8_t *palette) {
+    list_t *stick = self.sticks -> data[0].r;
+    uint8_t color[4];
+    for (int32_t c = 0; c < 4; c++) {
+        color[c] = turtleBufferChannel(stick -> data[STICK_RED + c].d / 255);
+    }
+    palette[0] = turtleBufferChannel(turtle.bgr / 255);
+    palette[1] = turtleBufferChannel(turtle.bgg / 255);
+    palette[2] = turtleBufferChannel(turtle.bgb / 255);
+    int32_t colors = 1;
+    while (colors < 256) {
+        uint8_t *last = palette + (colors - 1) * 3;
+        uint8_t *next = last + 3;
+        for (int32_t c = 0; c < 3; c++) {
+            next[c] = color[3] == 0 ? color[c] : turtleRasterMultiply(color[c], 255 - color[3]) + turtleRasterMultiply(last[c], color[3]);
+        }
+        if (memcmp(next, last, 3) == 0) {
+            break;
+        }
+        colors++;
+    }
+    return colors;
+}
+
+/* write the frames that were encoded last time in order */
+void exportWrite(export_job_t *job) {
+    for (int32_t i = 0; i < job -> writeCount; i++) {
+        export_frame_t *frame = &job -> writing[i];
+        if (job -> format == EXPORT_PNG) {
+            char filename[4096];
+            snprintf(filename, sizeof(filename), "%s%04d.png", job -> target, frame -> frame);
+            if (imageBufferWrite(&frame -> encoded, filename) == -1) {
+                job -> failed = 1;
+            }
+        } else if ((job -> format == EXPORT_Y4M && fwrite("FRAME\n", 1, 6, job -> stream) != 6) || fwrite(frame -> encoded.data, 1, frame -> encoded.length, job -> stream) != frame -> encoded.length) {
+            job -> failed = 1;
+        }
+    }
+}
+
+/* turtleRasterParallel work of one step of an export: index 0 writes the last step's frames while the others draw and encode this step's */
+void exportWork(void *data, int32_t index, int32_t thread) {
+    export_job_t *job = data;
+    if (index == 0) {
+        exportWrite(job);
+        return;
+    }
+    export_frame_t *frame = &job -> drawing[index - 1];
+    turtle_raster_t *raster = job -> rasters[thread];
+    turtleRasterClear(raster, turtle.bgr, turtle.bgg, turtle.bgb);
+    turtleRasterTriangles(raster, frame -> vertices, frame -> indices, frame -> indexCount);
+    frame -> encoded.length = 0;
+    if (job -> format == EXPORT_PNG) {
+        imageEncodePNG(&frame -> encoded, raster -> pixels, raster -> width, raster -> height);
+    } else if (job -> format == EXPORT_GIF || job -> format == EXPORT_APNG) {
+        if (frame -> indexed == NULL) {
+            frame -> indexed = malloc((size_t) raster -> width * raster -> height);
+        }
+        imagePaletteMap(frame -> indexed, raster -> pixels, (uint32_t) raster -> width * raster -> height, job -> palette, job -> colors);
+    } else {
+        uint32_t length = imageYUVLength(raster -> width, raster -> height);
+        imageBufferReserve(&frame -> encoded, length);
+        imageYUV420(frame -> encoded.data, raster -> pixels, raster -> width, raster -> height);
+        frame -> encoded.length = length;
+    }
+}
+
+/* turtleRasterParallel work that compresses the part of a GIF or APNG frame that differs from the frame before it (every frame must have been drawn) */
+void exportDeltaWork(void *data, int32_t index, int32_t thread) {
+    export_job_t *job = data;
+    export_frame_t *frame = &job -> drawing[index];
+    export_frame_t *previous = index > 0 ? &job -> drawing[index - 1] : (job -> writeCount > 0 ? &job -> writing[job -> writeCount - 1] : NULL);
+    int32_t rect[4] = {0, 0, job -> width, job -> height};
+    if (previous != NULL) {
+        imageChangedRect(rect, frame -> indexed, previous -> indexed, job -> width, job -> height);
+    }
+    frame -> encoded.length = 0;
+    if (job -> format == EXPORT_GIF) {
+        /* GIF delays are in hundredths of a second, so round the time each frame starts at rather than each delay */
+        int32_t delay = (int32_t) round(100.0 * (frame -> frame + 1) / self.framesPerSecond) - (int32_t) round(100.0 * frame -> frame / self.framesPerSecond);
+        imageGIFFrame(&frame -> encoded, frame -> indexed, job -> width, rect[0], rect[1], rect[2], rect[3], delay, job -> colors);
+    } else {
+        imageAPNGFrame(&frame -> encoded, frame -> indexed, job -> width, rect[0], rect[1], rect[2], rect[3], frame -> frame, 1, self.framesPerSecond);
+    }
+}
+
+/* export every frame of the current animation at width by height pixels
+   the turtle is not thread safe, so each step this thread tessellates the next few frames, then threads (0 for one for each core) draw and encode them with a raster each while one more thread writes out the frames of the step before. Only two steps of frames are ever held, however long the animation is
+   GIF and APNG frames are compressed in a second pass over the step once every frame of it is drawn, as each only stores what changed since the frame before. They repeat forever if the Loop switch is on. Returns -1 if the output could not be written */
+int32_t exportAnimation(export_format_t format, const char *target, int32_t width, int32_t height, int32_t threads) {
+    if (threads <= 0) {
+        threads = turtleRasterCores();
+    }
+    if (threads > TURTLE_RASTER_MAX_THREADS - 1) {
+        threads = TURTLE_RASTER_MAX_THREADS - 1;
+    }
+    export_job_t job;
+    job.format = format;
+    job.target = target;
+    job.stream = NULL;
+    job.width = width;
+    job.height = height;
+    job.failed = 0;
+    job.colors = exportPalette(job.palette);
+    if (format != EXPORT_PNG) {
+        if (strcmp(target, "-") == 0) {
+            job.stream = stdout;
+#ifdef OS_WINDOWS
+            _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        } else {
+            job.stream = fopen(target, "wb");
+            if (job.stream == NULL) {
+                return -1;
+            }
+        }
+        image_buffer_t header;
+        imageBufferInit(&header);
+        if (format == EXPORT_Y4M) {
+            imageY4MHeader(&header, width, height, self.framesPerSecond);
+        } else if (format == EXPORT_GIF) {
+            imageGIFHeader(&header, width, height, job.palette, job.colors, self.loop);
+        } else {
+            imageAPNGHeader(&header, width, height, job.palette, job.colors, self.currentAnimation -> length, self.loop);
+        }
+        if (fwrite(header.data, 1, header.length, job.stream) != header.length) {
+            job.failed = 1;
+        }
+        imageBufferFree(&header);
+        if (job.failed) {
+            if (job.stream != stdout) {
+                fclose(job.stream);
+            }
+            return -1;
+        }
+    }
+    int32_t step = threads; // frames drawn at once
+    export_frame_t *frames = calloc(step * 2, sizeof(export_frame_t));
+    for (int32_t i = 0; i < step * 2; i++) {
+        imageBufferInit(&frames[i].encoded);
+    }
+    job.drawing = frames;
+    job.writing = frames + step;
+    job.writeCount = 0;
+    job.rasters = malloc(sizeof(turtle_raster_t *) * (threads + 1));
+    for (int32_t i = 0; i < threads + 1; i++) {
+        job.rasters[i] = turtleRasterInit(width, height, 1);
+    }
+    stick_batch_t *batch = stickBatchInit();
+    stickBatchResize(batch, self.rig.joints, 1);
+    imageCRCInit();
+    for (int32_t start = 0; start < self.currentAnimation -> length; start += step) {
+        int32_t count = self.currentAnimation -> length - start < step ? self.currentAnimation -> length - start : step;
+        for (int32_t i = 0; i < count; i++) {
+            export_frame_t *frame = &job.drawing[i];
+            frame -> frame = start + i;
+            frame -> vertexCount = 0;
+            frame -> indexCount = 0;
+            renderExportFrame(batch, start + i);
+            turtle.vertexSink = exportSink;
+            turtle.sinkData = frame;
+            turtleTessellate(width, height);
+        }
+        turtle.vertexSink = NULL;
+        turtle.sinkData = NULL;
+        turtleRasterParallel(threads + 1, count + 1, exportWork, &job);
+        if (format == EXPORT_GIF || format == EXPORT_APNG) {
+            turtleRasterParallel(threads, count, exportDeltaWork, &job);
+        }
+        export_frame_t *swap = job.drawing;
+        job.drawing = job.writing;
+        job.writing = swap;
+        job.writeCount = count;
+    }
+    exportWrite(&job);
+    turtleClear();
+    if (job.stream != NULL) {
+        if (format == EXPORT_GIF && fputc(0x3B, job.stream) == EOF) { // trailer
+            job.failed = 1;
+        }
+        if (format == EXPORT_APNG) {
+            image_buffer_t end;
+            imageBufferInit(&end);
+            imagePNGChunk(&end, "IEND", NULL, 0);
+            if (fwrite(end.data, 1, end.length, job.stream) != end.length) {
+                job.failed = 1;
+            }
+            imageBufferFree(&end);
+        }
+        if (fflush(job.stream) != 0) {
+            job.failed = 1;
+        }
+        if (job.stream != stdout) {
+            fclose(job.stream);
+        }
+    }
+    for (int32_t i = 0; i < step * 2; i++) {
+        free(frames[i].vertices);
+        free(frames[i].indices);
+        free(frames[i].indexed);
+        imageBufferFree(&frames[i].encoded);
+    }
+    for (int32_t i = 0; i < threads + 1; i++) {
+        turtleRasterFree(job.rasters[i]);
+    }
+    free(frames);
+    free(job.rasters);
+    stickBatchFree(batch);
+    return job.failed ? -1 : 0;
+}
+
+/* export an animation with no window, returns the exit code. Messages go to stderr because a Y4M stream can be on stdout */
+int32_t exportHeadless(const char *filename, const char *rigFilename, int8_t localAngles, export_format_t format, const char *target, int32_t width, int32_t height, int32_t threads, int32_t loop) {
+    if (filename == NULL) {
+        fprintf(stderr, "Error: exporting needs an animation file\n");
+        return -1;
+    }
+    if (width <= 0 || height <= 0) {
+        fprintf(stderr, "Error: bad export size %dx%d\n", width, height);
+        return -1;
+    }
+    /* show at least the window's world coordinates (640 by 360), widened to the export's shape */
+    double aspect = (double) width / height;
+    int32_t halfWidth = 320;
+    int32_t halfHeight = 180;
+    if (aspect > 16.0 / 9) {
+        halfWidth = round(180 * aspect);
+    } else {
+        halfHeight = round(320 / aspect);
+    }
+    turtleInitHeadless(width, height, -halfWidth, -halfHeight, halfWidth, halfHeight);
+    turtleBgColor(255, 255, 255);
+    osToolsMemmap.mappedFiles = list_init(); // osToolsInit needs a window, importAnimation only needs file mapping
+    if (init(rigFilename) == -1) {
+        return -1;
+    }
+    setAngleSpace(localAngles);
+    list_delete(self.animations, 0);
+    if (importAnimation((char *) filename) == -1) {
+        fprintf(stderr, "Error: could not load %s\n", filename);
+        return -1;
+    }
+    loadCurrentAnimation(self.animations -> length - 1);
+    self.loop = loop;
+    int32_t result = exportAnimation(format, target, width, height, threads);
+    if (result == -1) {
+        fprintf(stderr, "Error: could not write %s\n", target);
+    } else {
+        fprintf(stderr, "Saved %d frames to %s\n", self.currentAnimation -> length, target);
+    }
+    turtleFree();
+    return result;
+}
+
 int main(int argc, char *argv[]) {
+    char *filename = NULL;
+    char *rigFilename = "include/stickRig.txt";
+    int8_t offline = 0;
+    int8_t localAngles = 0;
+    char *exportTarget = NULL;
+    export_format_t exportFormat = EXPORT_PNG;
+    int32_t exportWidth = 1280;
+    int32_t exportHeight = 720;
+    int32_t exportThreads = 0;
+    int32_t exportLoop = 1; // like the Loop switch, which starts on
+    for (int32_t i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--offline") == 0) {
+            offline = 1;
+        } else if (strcmp(argv[i], "--local") == 0) {
+            localAngles = 1;
+        } else if (strcmp(argv[i], "--rig") == 0 && i + 1 < argc) {
+            rigFilename = argv[++i];
+        } else if (strcmp(argv[i], "--png") == 0 && i + 1 < argc) {
+            exportFormat = EXPORT_PNG;
+            exportTarget = argv[++i];
+        } else if (strcmp(argv[i], "--y4m") == 0 && i + 1 < argc) {
+            exportFormat = EXPORT_Y4M;
+            exportTarget = argv[++i];
+        } else if (strcmp(argv[i], "--gif") == 0 && i + 1 < argc) {
+            exportFormat = EXPORT_GIF;
+            exportTarget = argv[++i];
+        } else if (strcmp(argv[i], "--apng") == 0 && i + 1 < argc) {
+            exportFormat = EXPORT_APNG;
+            exportTarget = argv[++i];
+        } else if (strcmp(argv[i], "--no-loop") == 0) {
+            exportLoop = 0;
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            char extra;
+            if (sscanf(argv[++i], "%dx%d%c", &exportWidth, &exportHeight, &extra) != 2) {
+                fprintf(stderr, "Error: --size takes WIDTHxHEIGHT, not %s\n", argv[i]);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            exportThreads = atoi(argv[++i]);
+        } else {
+            filename = argv[i];
+        }
+    }
+
+    if (exportTarget != NULL) {
+        return exportHeadless(filename, rigFilename, localAngles, exportFormat, exportTarget, exportWidth, exportHeight, exportThreads, exportLoop);
+    }
+
     /* Initialize glfw */
     if (!glfwInit()) {
         return -1;
@@ -1203,12 +2263,22 @@ int main(int argc, char *argv[]) {
     osToolsInit(argv[0], window); // must include argv[0] to get executableFilepath, must include GLFW window
     osToolsFileDialogAddExtension("sta"); // add sta to extension restrictions
 
-    init();
-
-    if (argc > 1) {
+    if (init(rigFilename) == -1) {
+        glfwTerminate();
+        return -1;
+    }
+    if (stickShaderInit(&self.stickShader, &self.rig) == 0) {
+        self.gpuSticksSupported = 1;
+        turtleInstanceRenderer(stickShaderDraw, &self.stickShader);
+    }
+    if (offline) {
+        self.timeSource = TIME_SOURCE_OFFLINE;
+    }
+    setAngleSpace(localAngles);
+    if (filename != NULL) {
         list_delete(self.animations, 0);
-        if (importAnimation(argv[1]) != -1) {
-            strcpy(osToolsFileDialog.selectedFilename, argv[1]);
+        if (importAnimation(filename) != -1) {
+            strcpy(osToolsFileDialog.selectedFilename, filename);
             self.animationSaveIndex = self.animations -> length - 1;
             loadCurrentAnimation(self.animationSaveIndex);
             self.currentFrame = 0;
@@ -1219,35 +2289,55 @@ int main(int argc, char *argv[]) {
 
     uint32_t tps = 120; // ticks per second (locked to fps in this case)
     uint64_t tick = 0; // count number of ticks since application started
-    clock_t start, end;
+    double start;
 
     while (turtle.shouldClose == 0) {
-        start = clock();
+        /* idle mode - when there is no input and nothing is playing, wait for events instead of building and hashing an identical frame */
+        if (self.idleMode) {
+            if (turtle.events != self.lastEvents || isAnimating()) {
+                self.lastEvents = turtle.events;
+                self.activeTicks = tps / 4; // let UI elements settle after the last event
+            } else if (self.activeTicks > 0) {
+                self.activeTicks--;
+            } else {
+                turtleWaitEvents(0.5);
+                continue;
+            }
+        }
+        start = glfwGetTime();
+        timeTick();
         turtleGetMouseCoords();
+        self.mouseWheel = turtleMouseWheel();
         turtleClear();
         tt_setColor(TT_COLOR_TEXT);
         turtleTextWriteStringf(-310, -170, 5, 0, "%.2lf, %.2lf", turtle.mouseX, turtle.mouseY);
         renderGrid();
         renderGround();
         renderOnions();
-        renderStick(self.sticks -> data[0].r);
+        renderStick(0);
         renderAnimations();
         if (self.mode) {
             renderDots(0);
+            pickDot();
             renderFrames();
         }
         handleUI();
         mouseTick();
+        clipTick();
         turtleToolsUpdate(); // update turtleTools
         parseRibbonOutput(); // user defined function to use ribbon
         parsePopupOutput(window); // user defined function to use popup
         turtleUpdate(); // update the screen
-        end = clock();
-        while ((double) (end - start) / CLOCKS_PER_SEC < (1.0 / tps)) {
-            end = clock();
+        if (self.timeSource == TIME_SOURCE_REALTIME) {
+            /* sleep (while still handling events) for the rest of the tick */
+            double remaining;
+            while ((remaining = 1.0 / tps - (glfwGetTime() - start)) > 0) {
+                glfwWaitEventsTimeout(remaining);
+            }
         }
         tick++;
     }
+    stickShaderFree(&self.stickShader);
     turtleFree();
     glfwTerminate();
     return 0;